@@ -0,0 +1,180 @@
+// stdlib
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// internal
+#include "systems/ai_system.hpp"
+#include "systems/physics_system.hpp"
+#include "systems/render_system.hpp"
+#include "systems/world_system.hpp"
+#include "systems/animation_system.hpp"
+#include "systems/upgrade_system.hpp"
+#include "systems/particle_system.hpp"
+#include "systems/tick_systems.hpp"
+#include "util/screen_manager.hpp"
+#include "util/frame_profiler.hpp"
+#include "util/asset_pack.hpp"
+#include "util/system_scheduler.hpp"
+#include "util/rng.hpp"
+#include "headless_platform.hpp"
+#include "input_script.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Runs the game's simulation without a window, GL context or audio device, as fast as it goes,
+// and reports the simulation throughput in ticks per second:
+//   SkySeekerHeadless [--ticks <count>] [--tick-rate <ticks per second>] [--script <file>] [--horde <count>]
+//                     [--seed <number>] [--profile]
+// Each tick is exactly what the game runs for one fixed timestep (see tick_systems.cpp), with
+// input from a script (input_script.hpp) instead of the keyboard and mouse. When the player dies
+// the room is restarted, as if they went back through the menu.
+// The starting room has no waves, so unless --horde says otherwise it is kept topped up with
+// HEADLESS_DEFAULT_HORDE enemies for the script to fight; --horde 0 measures the empty room.
+// Runs are deterministic: the same seed, script and arguments give the same run, which the state
+// checksum printed at the end confirms, so performance changes are measured on identical work.
+const uint64_t HEADLESS_DEFAULT_SEED = 1;
+const unsigned int HEADLESS_DEFAULT_HORDE = 20;
+
+// hashes where everything is and how healthy it is, FNV-1a over the raw bits
+static uint64_t state_checksum() {
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			hash = (hash ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+		}
+	};
+	for (size_t i = 0; i < registry.positions.size(); i++) {
+		unsigned int entity = registry.positions.entities[i];
+		add(&entity, sizeof(entity));
+		add(&registry.positions.components[i].position, sizeof(vec2));
+	}
+	for (const Living& living : registry.livings.components) {
+		add(&living.current_health, sizeof(living.current_health));
+	}
+	return hash;
+}
+
+int main(int argc, char* argv[])
+{
+	int tick_count = 10000;
+	float tick_rate = 60.f;
+	unsigned int horde_size = HEADLESS_DEFAULT_HORDE;
+	uint64_t seed = HEADLESS_DEFAULT_SEED;
+	InputScript script;
+	if (!script.load_default()) {
+		return EXIT_FAILURE;
+	}
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--ticks" && i + 1 < argc) {
+			tick_count = std::stoi(argv[++i]);
+		}
+		else if (arg == "--tick-rate" && i + 1 < argc) {
+			tick_rate = std::stof(argv[++i]);
+			if (tick_rate <= 0.f) {
+				std::cerr << "ERROR: --tick-rate must be above 0" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--script" && i + 1 < argc) {
+			if (!script.load_file(argv[++i])) {
+				return EXIT_FAILURE;
+			}
+		}
+		else if (arg == "--horde" && i + 1 < argc) {
+			horde_size = (unsigned int)std::stoi(argv[++i]);
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			seed = std::stoull(argv[++i]);
+		}
+		else if (arg == "--profile") {
+			frame_profiler.enabled = true;
+		}
+		else {
+			std::cerr << "ERROR: unknown argument " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	const float tick_ms = 1000.f / tick_rate;
+	rng.seed(seed);
+
+	if (asset_pack.open(AssetPack::pack_path())) {
+		std::cout << "Using asset pack " << AssetPack::pack_path() << std::endl;
+	}
+
+	// global systems
+	AISystem	  	ai_system;
+	WorldSystem   	world_system;
+	RenderSystem  	renderer_system;
+	PhysicsSystem 	physics_system;
+	PlayerSystem  	player_system;
+	EnemySystem   	enemy_system;
+	AnimationSystem animation_system;
+	ItemSystem		item_system;
+	ParticleSystem	particle_system;
+	UpgradeSystem   upgrade_system;
+	ScreenManager 	screen_manager(&renderer_system, &world_system, &upgrade_system);
+	ai_system.deterministic = true;
+
+	// the same startup as the game, against the headless window, renderer and audio
+	GLFWwindow* window = world_system.create_window();
+	world_system.start_and_load_sounds();
+	renderer_system.init(window);
+	player_system.init(renderer_system);
+	enemy_system.init(renderer_system);
+	item_system.init(renderer_system);
+	upgrade_system.init(renderer_system);
+	particle_system.init(renderer_system);
+	ai_system.init(&enemy_system);
+	world_system.init(&renderer_system, &player_system, &enemy_system, &item_system, &screen_manager, &upgrade_system, &particle_system, &ai_system);
+	world_system.set_horde_size(horde_size);
+
+	SystemScheduler tick_systems;
+	add_tick_systems(tick_systems, world_system, player_system, ai_system, enemy_system, item_system, animation_system, physics_system, particle_system);
+	if (frame_profiler.enabled) {
+		tick_systems.print_graph();
+	}
+
+	// straight into the game, as "Play" on the start screen does
+	Entity screen_state_entity = renderer_system.get_screen_state_entity();
+	registry.screenStates.get(screen_state_entity).tutorialActive = false;
+	screen_manager.setScreen(ScreenType::PlayScreen);
+
+	int deaths = 0;
+	size_t most_enemies = 0;
+	auto start = Clock::now();
+	int tick = 0;
+	for (; tick < tick_count && !HeadlessPlatform::should_close(); tick++) {
+		frame_profiler.begin_frame();
+		script.play(tick);
+		// the script may pause or open a menu, the simulation waits like it does in the game
+		screen_manager.handleInput(window);
+		frame_profiler.mark("input");
+
+		ScreenType screen = screen_manager.getCurrentScreen();
+		if (screen == ScreenType::PlayScreen || screen == ScreenType::TutorialScreen) {
+			tick_systems.run(tick_ms);
+		}
+		frame_profiler.mark("simulation");
+		most_enemies = std::max(most_enemies, registry.enemies.size());
+
+		if (screen_manager.getCurrentScreen() == ScreenType::DeathScreen) {
+			deaths++;
+			registry.screenStates.get(screen_state_entity).is_death = false;
+			screen_manager.restartGame();
+			screen_manager.setScreen(ScreenType::PlayScreen);
+		}
+		frame_profiler.end_frame();
+	}
+	float elapsed_s = (float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1000000.f;
+
+	std::cout << "Headless: " << tick << " ticks of " << tick_ms << " ms (" << tick * tick_ms / 1000.f << " s of game time) in "
+		<< elapsed_s << " s" << std::endl;
+	std::cout << "  " << tick / elapsed_s << " ticks/s, " << elapsed_s * 1000.f / tick << " ms per tick, "
+		<< tick * tick_ms / 1000.f / elapsed_s << "x real time" << std::endl;
+	std::cout << "  at most " << most_enemies << " enemies, player died " << deaths << " times" << std::endl;
+	std::cout << "  seed " << seed << ", state checksum " << std::hex << state_checksum() << std::dec << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,193 @@
+#include "headless_platform.hpp"
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+#include <array>
+
+// GLFW only declares the window type, the headless build defines it
+struct GLFWwindow {
+	void* user_pointer = nullptr;
+	GLFWkeyfun key_callback = nullptr;
+	GLFWcursorposfun cursor_pos_callback = nullptr;
+	GLFWmousebuttonfun mouse_button_callback = nullptr;
+	std::array<int, GLFW_KEY_LAST + 1> keys = {};
+	std::array<int, GLFW_MOUSE_BUTTON_LAST + 1> mouse_buttons = {};
+	vec2 cursor = { 0.f, 0.f };
+	bool should_close = false;
+};
+
+// the game opens a single window
+static GLFWwindow headless_window;
+
+void HeadlessPlatform::key(int key, int action) {
+	if (key >= 0 && key <= GLFW_KEY_LAST) {
+		headless_window.keys[key] = action == GLFW_RELEASE ? GLFW_RELEASE : GLFW_PRESS;
+	}
+	if (headless_window.key_callback) {
+		headless_window.key_callback(&headless_window, key, 0, action, 0);
+	}
+}
+
+void HeadlessPlatform::cursor(vec2 position) {
+	headless_window.cursor = position;
+	if (headless_window.cursor_pos_callback) {
+		headless_window.cursor_pos_callback(&headless_window, position.x, position.y);
+	}
+}
+
+void HeadlessPlatform::mouse_button(int button, int action) {
+	if (button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST) {
+		headless_window.mouse_buttons[button] = action;
+	}
+	if (headless_window.mouse_button_callback) {
+		headless_window.mouse_button_callback(&headless_window, button, action, 0);
+	}
+}
+
+bool HeadlessPlatform::should_close() {
+	return headless_window.should_close;
+}
+
+//
+// OpenGL: gl3w is never loaded, gl_has_errors is the only GL call the simulation reaches
+//
+static GLenum APIENTRY headless_gl_get_error() {
+	return GL_NO_ERROR;
+}
+
+PFNGLGETERRORPROC gl3wGetError = headless_gl_get_error;
+
+//
+// GLFW
+//
+int glfwInit(void) {
+	return GLFW_TRUE;
+}
+
+GLFWerrorfun glfwSetErrorCallback(GLFWerrorfun callback) {
+	return nullptr;
+}
+
+void glfwWindowHint(int hint, int value) {
+}
+
+GLFWwindow* glfwCreateWindow(int width, int height, const char* title, GLFWmonitor* monitor, GLFWwindow* share) {
+	return &headless_window;
+}
+
+void glfwDestroyWindow(GLFWwindow* window) {
+}
+
+void glfwMakeContextCurrent(GLFWwindow* window) {
+}
+
+int glfwWindowShouldClose(GLFWwindow* window) {
+	return window->should_close;
+}
+
+void glfwSetWindowShouldClose(GLFWwindow* window, int value) {
+	window->should_close = value;
+}
+
+void glfwSetWindowTitle(GLFWwindow* window, const char* title) {
+}
+
+void glfwSetWindowUserPointer(GLFWwindow* window, void* pointer) {
+	window->user_pointer = pointer;
+}
+
+void* glfwGetWindowUserPointer(GLFWwindow* window) {
+	return window->user_pointer;
+}
+
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow* window, GLFWkeyfun callback) {
+	GLFWkeyfun previous = window->key_callback;
+	window->key_callback = callback;
+	return previous;
+}
+
+GLFWcursorposfun glfwSetCursorPosCallback(GLFWwindow* window, GLFWcursorposfun callback) {
+	GLFWcursorposfun previous = window->cursor_pos_callback;
+	window->cursor_pos_callback = callback;
+	return previous;
+}
+
+GLFWmousebuttonfun glfwSetMouseButtonCallback(GLFWwindow* window, GLFWmousebuttonfun callback) {
+	GLFWmousebuttonfun previous = window->mouse_button_callback;
+	window->mouse_button_callback = callback;
+	return previous;
+}
+
+int glfwGetKey(GLFWwindow* window, int key) {
+	return key >= 0 && key <= GLFW_KEY_LAST ? window->keys[key] : GLFW_RELEASE;
+}
+
+int glfwGetMouseButton(GLFWwindow* window, int button) {
+	return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST ? window->mouse_buttons[button] : GLFW_RELEASE;
+}
+
+void glfwGetCursorPos(GLFWwindow* window, double* xpos, double* ypos) {
+	*xpos = window->cursor.x;
+	*ypos = window->cursor.y;
+}
+
+//
+// SDL and SDL_mixer: every sound is the same empty chunk, nothing is ever played
+//
+static Mix_Chunk silent_chunk = {};
+static int silent_music = 0;
+
+int SDL_Init(Uint32 flags) {
+	return 0;
+}
+
+SDL_RWops* SDL_RWFromFile(const char* file, const char* mode) {
+	return nullptr;
+}
+
+SDL_RWops* SDL_RWFromConstMem(const void* mem, int size) {
+	return nullptr;
+}
+
+int Mix_OpenAudio(int frequency, Uint16 format, int channels, int chunksize) {
+	return 0;
+}
+
+void Mix_CloseAudio(void) {
+}
+
+Mix_Chunk* Mix_LoadWAV_RW(SDL_RWops* src, int freesrc) {
+	return &silent_chunk;
+}
+
+Mix_Music* Mix_LoadMUS(const char* file) {
+	return (Mix_Music*)&silent_music;
+}
+
+Mix_Music* Mix_LoadMUS_RW(SDL_RWops* src, int freesrc) {
+	return (Mix_Music*)&silent_music;
+}
+
+void Mix_FreeChunk(Mix_Chunk* chunk) {
+}
+
+void Mix_FreeMusic(Mix_Music* music) {
+}
+
+int Mix_VolumeChunk(Mix_Chunk* chunk, int volume) {
+	return MIX_MAX_VOLUME;
+}
+
+int Mix_PlayChannelTimed(int channel, Mix_Chunk* chunk, int loops, int ticks) {
+	return 0;
+}
+
+int Mix_PlayMusic(Mix_Music* music, int loops) {
+	return 0;
+}
+
+int Mix_HaltMusic(void) {
+	return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common.hpp"
+
+// Stand-ins for the OpenGL, GLFW, SDL and SDL_mixer calls the game makes, so the simulation links and
+// runs without a display, a GL context or an audio device. glfwCreateWindow hands out a fake
+// window, sounds load as empty handles and play silently.
+// Input is injected below: it updates the key and button state the game polls and calls the
+// callbacks the game registered on the window, the same way GLFW does for a real device.
+class HeadlessPlatform {
+public:
+	static void key(int key, int action);
+	static void cursor(vec2 position);
+	static void mouse_button(int button, int action);
+
+	// true once the game asked the window to close
+	static bool should_close();
+};
@@ -0,0 +1,104 @@
+// RenderSystem for the headless build, in place of render_system.cpp and render_system_init.cpp.
+// Nothing is drawn and no GL call is made: textures are still shared and counted by path, but
+// get made-up handles instead of being decoded and uploaded, so the systems that store handles in
+// their components run unchanged.
+#include "systems/render_system.hpp"
+#include "tinyECS/registry.hpp"
+
+#include <cassert>
+
+// handles are only compared and copied by the simulation, any unique number will do
+static GLuint next_texture_handle = 1;
+
+bool RenderSystem::init(GLFWwindow* window_arg)
+{
+	this->window = window_arg;
+
+	// create a single entry
+	registry.screenStates.emplace(screen_state_entity);
+
+	initializeGlTextures();
+	return true;
+}
+
+RenderSystem::~RenderSystem()
+{
+	while (registry.textureinfos.entities.size() > 0) {
+		registry.remove_all_components_of(registry.textureinfos.entities.back());
+	}
+}
+
+void RenderSystem::shutdown(GLFWwindow* window) {
+}
+
+void RenderSystem::initializeGlTextures()
+{
+	loadGlTextures(texture_gl_handles.data(), texture_paths.data(), texture_gl_handles.size());
+}
+
+void RenderSystem::loadGlTextures(GLuint* handles, const std::string* texture_paths, size_t num_textures) {
+	for (size_t i = 0; i < num_textures; i++) {
+		handles[i] = acquireTexture(texture_paths[i]);
+	}
+}
+
+GLuint RenderSystem::acquireTexture(const std::string& path) {
+	CachedTexture& cached = texture_cache[path];
+	if (cached.references == 0) {
+		cached.handle = next_texture_handle++;
+	}
+	cached.references++;
+	return cached.handle;
+}
+
+GLuint RenderSystem::acquireTexture(DecodedTexture& texture) {
+	return acquireTexture(texture.path);
+}
+
+void RenderSystem::releaseTexture(const std::string& path) {
+	auto it = texture_cache.find(path);
+	assert(it != texture_cache.end() && "Releasing a texture that was never acquired");
+	if (it == texture_cache.end()) {
+		return;
+	}
+	it->second.references--;
+	if (it->second.references == 0) {
+		texture_cache.erase(it);
+	}
+}
+
+// pixels are never needed, so files are not even read
+bool RenderSystem::decodeTexture(const std::string& path, DecodedTexture& texture) {
+	texture.path = path;
+	return true;
+}
+
+void RenderSystem::beginTextureBatch() {
+}
+
+void RenderSystem::endTextureBatch() {
+}
+
+void RenderSystem::reloadChangedShaders() {
+}
+
+void RenderSystem::draw() {
+}
+
+void RenderSystem::drawItemStat(Entity& item_entity) {
+}
+
+void RenderSystem::drawStartScreen(ScreenManager& screenManager) {
+}
+
+void RenderSystem::drawPausedScreen(ScreenManager& screenManager) {
+}
+
+void RenderSystem::drawCreditsScreen(ScreenManager& screenManager) {
+}
+
+void RenderSystem::drawUpgradeScreen(ScreenManager& screenManager, UpgradeSystem& upgrade_system) {
+}
+
+void RenderSystem::drawDeathScreen(ScreenManager& screenManager) {
+}
@@ -0,0 +1,177 @@
+#include "input_script.hpp"
+#include "headless_platform.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char* DEFAULT_INPUT_SCRIPT = R"(
+# fights the horde the headless runner keeps in the starting room: one side of the square every
+# two seconds at 60 ticks per second, swinging, firing and dashing along the way. The player stays
+# in the middle of the window, so the cursor aims ahead of them, into whatever they walk toward
+repeat 480
+0 key D press
+0 mouse 720 360
+30 button left press
+31 button left release
+40 button right press
+80 button right release
+90 button left press
+91 button left release
+100 key SPACE press
+101 key SPACE release
+120 key D release
+120 key S press
+120 mouse 490 600
+150 button left press
+151 button left release
+160 button right press
+200 button right release
+210 button left press
+211 button left release
+220 key SPACE press
+221 key SPACE release
+240 key S release
+240 key A press
+240 mouse 260 360
+270 button left press
+271 button left release
+280 button right press
+320 button right release
+330 button left press
+331 button left release
+340 key SPACE press
+341 key SPACE release
+360 key A release
+360 key W press
+360 mouse 490 120
+390 button left press
+391 button left release
+400 button right press
+440 button right release
+450 button left press
+451 button left release
+460 key SPACE press
+461 key SPACE release
+479 key W release
+)";
+
+static bool parse_key(const std::string& name, int& key) {
+	if (name.size() == 1 && ((name[0] >= 'A' && name[0] <= 'Z') || (name[0] >= '0' && name[0] <= '9'))) {
+		// GLFW codes letters and digits by their ASCII value
+		key = name[0];
+		return true;
+	}
+	if (name == "SPACE") key = GLFW_KEY_SPACE;
+	else if (name == "ENTER") key = GLFW_KEY_ENTER;
+	else if (name == "ESCAPE") key = GLFW_KEY_ESCAPE;
+	else if (name == "TAB") key = GLFW_KEY_TAB;
+	else {
+		std::istringstream code(name);
+		return (bool)(code >> key);
+	}
+	return true;
+}
+
+static bool parse_action(const std::string& name, int& action) {
+	if (name == "press") action = GLFW_PRESS;
+	else if (name == "release") action = GLFW_RELEASE;
+	else return false;
+	return true;
+}
+
+bool InputScript::load(std::istream& in, const std::string& name) {
+	events.clear();
+	repeat_ticks = 0;
+	next_event = 0;
+
+	std::string line;
+	int line_number = 0;
+	while (std::getline(in, line)) {
+		line_number++;
+		std::istringstream words(line);
+		std::string first;
+		if (!(words >> first) || first[0] == '#') {
+			continue;
+		}
+
+		bool valid = true;
+		if (first == "repeat") {
+			valid = (bool)(words >> repeat_ticks) && repeat_ticks > 0;
+		}
+		else {
+			Event event = {};
+			std::string type, argument, action;
+			std::istringstream tick(first);
+			valid = (bool)(tick >> event.tick) && event.tick >= 0 && (bool)(words >> type);
+			if (valid && type == "key") {
+				event.type = EventType::KEY;
+				valid = (bool)(words >> argument >> action) && parse_key(argument, event.code) && parse_action(action, event.action);
+			}
+			else if (valid && type == "button") {
+				event.type = EventType::BUTTON;
+				valid = (bool)(words >> argument >> action) && parse_action(action, event.action);
+				if (argument == "left") event.code = GLFW_MOUSE_BUTTON_LEFT;
+				else if (argument == "right") event.code = GLFW_MOUSE_BUTTON_RIGHT;
+				else valid = false;
+			}
+			else if (valid && type == "mouse") {
+				event.type = EventType::MOUSE;
+				valid = (bool)(words >> event.position.x >> event.position.y);
+			}
+			else {
+				valid = false;
+			}
+			if (valid) {
+				events.push_back(event);
+			}
+		}
+
+		if (!valid) {
+			std::cerr << "ERROR: " << name << ":" << line_number << ": can't read \"" << line << "\"" << std::endl;
+			return false;
+		}
+	}
+
+	// events on the same tick keep the order they were written in
+	std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.tick < b.tick; });
+	return true;
+}
+
+bool InputScript::load_file(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		std::cerr << "ERROR: can't open input script " << path << std::endl;
+		return false;
+	}
+	return load(file, path);
+}
+
+bool InputScript::load_default() {
+	std::istringstream script(DEFAULT_INPUT_SCRIPT);
+	return load(script, "default input script");
+}
+
+void InputScript::play(int tick) {
+	if (repeat_ticks > 0) {
+		tick %= repeat_ticks;
+		if (tick == 0) {
+			next_event = 0;
+		}
+	}
+	while (next_event < events.size() && events[next_event].tick <= tick) {
+		const Event& event = events[next_event++];
+		switch (event.type) {
+		case EventType::KEY:
+			HeadlessPlatform::key(event.code, event.action);
+			break;
+		case EventType::BUTTON:
+			HeadlessPlatform::mouse_button(event.code, event.action);
+			break;
+		case EventType::MOUSE:
+			HeadlessPlatform::cursor(event.position);
+			break;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.hpp"
+#include <istream>
+#include <string>
+#include <vector>
+
+// Scripted input for the headless runner, one event per line:
+//   <tick> key <A-Z | 0-9 | SPACE | ENTER | ESCAPE | TAB | glfw key code> press|release
+//   <tick> button left|right press|release
+//   <tick> mouse <x> <y>              cursor position in window pixels
+//   repeat <ticks>                    plays the script again every that many ticks
+// Lines starting with # are comments. Ticks count from the start of the run (or of each repeat).
+class InputScript {
+public:
+	// replaces the script with the one read from in, name is only used in error messages
+	bool load(std::istream& in, const std::string& name);
+	bool load_file(const std::string& path);
+
+	// the built in script: walks a square around the room while swinging, firing and dashing at
+	// the enemies the headless runner keeps in the room
+	bool load_default();
+
+	// sends the events of tick to the headless window, called once for every tick in order
+	void play(int tick);
+
+private:
+	enum class EventType {
+		KEY,
+		BUTTON,
+		MOUSE
+	};
+
+	struct Event {
+		int tick;
+		EventType type;
+		int code;
+		int action;
+		vec2 position;
+	};
+
+	std::vector<Event> events;
+	// 0 plays the script once
+	int repeat_ticks = 0;
+	size_t next_event = 0;
+};
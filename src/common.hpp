@@ -43,6 +43,11 @@ const int WINDOW_HEIGHT_PX = 720;
 const vec3 BACKGROUND_COLOUR = vec3(0x17, 0x28, 0x32) / 255.f;
 
 const int AI_PATHFINDING_INTERVAL_MS = 200;	// number of milliseconds between pathfinding passes
+const int AI_PRIORITY_UPDATE_MS = 50;		// update interval for enemies that are walking or near the player
+const float AI_PRIORITY_RANGE_TILES = 5.f;	// distance from the player, in tiles, that counts as near
+const int AI_FRAME_BUDGET_US = 500;		// time per frame the AI scheduler may spend on per-enemy updates
+const int AI_DETERMINISTIC_UPDATES = 64;	// per-enemy updates per frame in place of the time budget, in deterministic mode
+const int HORDE_SPAWNS_PER_STEP = 50;		// enemies horde mode may add per step while filling the room
 
 const int GRID_CELL_WIDTH_PX = 60;
 const int GRID_CELL_HEIGHT_PX = 60;
@@ -71,6 +76,9 @@ const float ITEM_PICKUP_SPREAD_TIME = 500.f;
 const float ITEM_PICKUP_MAX_SPREAD_DISTANCE = BASE_TILE_SIZE_WIDTH;
 const float ITEM_PICKUP_MIN_DELAY = 250.f;
 
+const float ENEMY_SEPARATION_RADIUS = BASE_TILE_SIZE_WIDTH * 0.75f;	// enemies closer than this push each other apart
+const float ENEMY_SEPARATION_WEIGHT = 0.75f;	// strongest separation push, as a fraction of the enemy's speed
+
 const float BASE_DASH_TIME = 150.f;
 
 const float DASH_SPEED_MODIFIER = 4.0f;
@@ -0,0 +1,142 @@
+#include "enemy_types.hpp"
+#include "../../ext/nlohmann/json.hpp"
+#include "../util/asset_pack.hpp"
+#include <iostream>
+#include <unordered_map>
+#include <cassert>
+
+std::vector<Enemy_Template> enemy_templates;
+std::vector<Enemy_Transition> enemy_transitions;
+
+static const std::unordered_map<std::string, ENEMY_TYPE> built_in_types = {
+	{ "debug", DEBUG_ENEMY },
+	{ "charger", CHARGER },
+	{ "ranged", RANGED },
+	{ "boss", BOSS }
+};
+
+static const std::unordered_map<std::string, ENEMY_STATES> state_names = {
+	{ "idle", ENEMY_IDLE },
+	{ "walking", ENEMY_WALKING },
+	{ "attacking", ENEMY_ATTACKING },
+	{ "recovering", ENEMY_RECOVERING },
+	{ "flinch", ENEMY_FLINCH },
+	{ "winding_up", ENEMY_WINDING_UP },
+	{ "dying", ENEMY_DYING }
+};
+
+static const std::unordered_map<std::string, ENEMY_ACTION> action_names = {
+	{ "none", ENEMY_ACTION_NONE },
+	{ "attack", ENEMY_ACTION_ATTACK },
+	{ "end_attack", ENEMY_ACTION_END_ATTACK },
+	{ "cancel_attack", ENEMY_ACTION_CANCEL_ATTACK }
+};
+
+static ENEMY_STATES get_state(const std::string& enemy_name, const std::string& state_name) {
+	auto it = state_names.find(state_name);
+	if (it == state_names.end()) {
+		std::cerr << "Enemy " << enemy_name << " uses unknown state " << state_name << std::endl;
+		assert(false && "Unknown enemy state");
+		return ENEMY_IDLE;
+	}
+	return it->second;
+}
+
+static vec2 get_vec2(const nlohmann::json& value) {
+	return vec2((float)value[0], (float)value[1]);
+}
+
+static Enemy_Template parse_template(const nlohmann::json& enemy) {
+	Enemy_Template enemy_template;
+	enemy_template.name = enemy["name"];
+	enemy_template.SPRITE_PATH = textures_path(std::string(enemy["sprite"]));
+	// distances are in tiles
+	enemy_template.speed = BASE_TILE_SIZE_HEIGHT * (float)enemy["speed"];
+	enemy_template.attack_range = BASE_TILE_SIZE_HEIGHT * (float)enemy["attack_range"];
+	enemy_template.souls_value = enemy["souls"];
+	enemy_template.health_value = enemy["health_drops"];
+	enemy_template.spawn_weight = enemy["spawn_weight"];
+	enemy_template.stops_to_attack = enemy["stops_to_attack"];
+
+	enemy_template.ACTUAL_SIZE = get_vec2(enemy["actual_size"]);
+	enemy_template.COLLISION_OFFSET = get_vec2(enemy["collision_offset"]);
+	// relative_size is how many tiles tall the enemy's body is
+	enemy_template.RELATIVE_SIZE = (float)enemy["relative_size"] * BASE_TILE_SIZE_HEIGHT / enemy_template.ACTUAL_SIZE.y;
+	enemy_template.SPRITE_SIZE = get_vec2(enemy["sprite_size"]);
+
+	const nlohmann::json& stats = enemy["stats"];
+	enemy_template.max_health = stats["max_health"];
+	enemy_template.current_health = enemy_template.max_health;
+	enemy_template.attack = stats["attack"];
+	enemy_template.defense = stats["defense"];
+	enemy_template.special_attack = stats["special_attack"];
+	enemy_template.crit_rate = stats["crit_rate"];
+	enemy_template.crit_damage = stats["crit_damage"];
+
+	for (const nlohmann::json& attack : enemy["attacks"]) {
+		Enemy_Attack enemy_attack;
+		if (attack["type"] == "projectile") {
+			enemy_attack.kind = ENEMY_ATTACK_PROJECTILE;
+			enemy_attack.projectiles = attack["count"];
+		}
+		else {
+			enemy_attack.kind = ENEMY_ATTACK_CHARGE;
+		}
+		enemy_template.attacks.push_back(enemy_attack);
+	}
+	return enemy_template;
+}
+
+// compiles the archetype's "states" object into its rows of enemy_transitions
+static void compile_states(int type, const std::string& enemy_name, const nlohmann::json& states) {
+	for (auto& state : states.items()) {
+		ENEMY_STATES from = get_state(enemy_name, state.key());
+		Enemy_Transition& transition = enemy_transitions[type * enemy_state_count + (int)from];
+		const nlohmann::json& row = state.value();
+		if (row.contains("duration_ms")) {
+			transition.duration_ms = row["duration_ms"];
+		}
+		if (row.contains("next")) {
+			transition.next = get_state(enemy_name, row["next"]);
+		}
+		if (row.contains("on_enter")) {
+			auto action = action_names.find(row["on_enter"]);
+			if (action == action_names.end()) {
+				std::cerr << "Enemy " << enemy_name << " uses unknown action " << row["on_enter"] << std::endl;
+				assert(false && "Unknown enemy action");
+				continue;
+			}
+			transition.on_enter = action->second;
+		}
+	}
+}
+
+void load_enemy_types() {
+	auto data = load_json(json_path("enemies.json"));
+
+	// built-in types keep their enum value, the rest follow in file order
+	int type_count = NUM_ENEMY_TYPES;
+	for (const nlohmann::json& enemy : data) {
+		if (built_in_types.find(enemy["name"].get<std::string>()) == built_in_types.end()) {
+			type_count++;
+		}
+	}
+	enemy_templates = std::vector<Enemy_Template>(type_count);
+	enemy_transitions = std::vector<Enemy_Transition>(type_count * enemy_state_count);
+
+	int next_type = NUM_ENEMY_TYPES;
+	for (const nlohmann::json& enemy : data) {
+		std::string name = enemy["name"];
+		auto built_in = built_in_types.find(name);
+		int type = built_in != built_in_types.end() ? (int)built_in->second : next_type++;
+		enemy_templates[type] = parse_template(enemy);
+		compile_states(type, name, enemy["states"]);
+	}
+
+	for (int type = 0; type < NUM_ENEMY_TYPES; type++) {
+		if (enemy_templates[type].name.empty()) {
+			std::cerr << "enemies.json is missing a built-in enemy type " << type << std::endl;
+			assert(false && "Missing built-in enemy type");
+		}
+	}
+}
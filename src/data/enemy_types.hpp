@@ -3,29 +3,57 @@
 #include "../common.hpp"
 #include "data_structs.hpp"
 #include "states.hpp"
-#include <map>
+#include <vector>
+#include <cmath>
 
-enum ENEMY_TYPE {
+// Enemy archetypes and their state machines live in data/json/enemies.json.
+// The built-in names below are referenced by code, anything else in the file gets an id after NUM_ENEMY_TYPES.
+enum ENEMY_TYPE : int {
 	DEBUG_ENEMY = 0,
 	CHARGER,
 	RANGED,
 	BOSS,
 	NUM_ENEMY_TYPES
 };
-const int enemy_type_count = (int)NUM_ENEMY_TYPES;
+
+// runs when an enemy enters a state
+enum ENEMY_ACTION {
+	ENEMY_ACTION_NONE = 0,
+	ENEMY_ACTION_ATTACK,		// perform one of the archetype's attacks, chosen at random
+	ENEMY_ACTION_END_ATTACK,	// drop the attack and stop moving
+	ENEMY_ACTION_CANCEL_ATTACK	// drop the attack but keep any knockback
+};
+
+enum ENEMY_ATTACK_KIND {
+	ENEMY_ATTACK_CHARGE = 0,
+	ENEMY_ATTACK_PROJECTILE
+};
+
+struct Enemy_Attack {
+	ENEMY_ATTACK_KIND kind = ENEMY_ATTACK_CHARGE;
+	int projectiles = 1;
+};
+
+// one row of a compiled state machine, looked up by [type][state]
+struct Enemy_Transition {
+	float duration_ms = INFINITY;	// time spent in the state before moving on, states without a timeout never expire
+	ENEMY_STATES next = ENEMY_IDLE;
+	ENEMY_ACTION on_enter = ENEMY_ACTION_NONE;
+};
 
 struct Enemy_Template {
+	std::string name;
 	float speed = BASE_TILE_SIZE_HEIGHT * 1.75f;
-	float windup_time_ms = 0.f;
-	float attack_time_ms = 0.f;
-	float recovery_time_ms = 0.f;
 	int souls_value = 5;
 	int health_value = 1;
 	float attack_range = 0.0f;
+	float spawn_weight = 0.f;
+	bool stops_to_attack = true;	// drop the move node while attacking
+	std::vector<Enemy_Attack> attacks;
 
-	const std::string SPRITE_PATH;
+	std::string SPRITE_PATH;
 
-	GLuint enemy_handle;
+	GLuint enemy_handle = 0;
 	std::array<std::vector<TextureCoords>, enemy_state_count> texture_coords; // Dynamic because there is a dynamic number of animations. Could be hard-coded.
 
 	bool flipped = false;
@@ -45,129 +73,14 @@ struct Enemy_Template {
 	float invincible_time = 0.0f;
 };
 
-static Enemy_Template debug_template = {
-	0,
-	0,
-	0,
-	0,
-	0,
-	0,
-	0,
-
-	textures_path("invaders/floater_3.png"),
-
-	0,
-	std::array<std::vector<TextureCoords>, enemy_state_count>(), // Dynamic because there is a dynamic number of animations. Could be hard-coded.
-
-	false,
-	vec2(42, 40),
-	vec2(0, 0),
-
-	0.5f * BASE_TILE_SIZE_HEIGHT / 40,
-	vec2(48, 48) * (0.5f * BASE_TILE_SIZE_HEIGHT / 40),
-	100.0f,
-	100.0f,
-	10.0f,
-	10.0f,
-	10.0f,
-	.05f,
-	2.0f,
-	0.0f
-};
-
-static Enemy_Template charger_template = {
-	BASE_TILE_SIZE_HEIGHT * 1.75f,	// speed
-	500.f,							// windup time
-	300.f,							// attack time
-	1500.f,							// recovery time
-	5,								// souls
-	1,								// health drops
-	BASE_TILE_SIZE_HEIGHT * 2.0f,	// range
-
-	textures_path("enemies/Soldier.png"),
-
-	0,	// texture handle
-	std::array<std::vector<TextureCoords>, enemy_state_count>(), // Dynamic because there is a dynamic number of animations. Could be hard-coded.
+// indexed by ENEMY_TYPE
+extern std::vector<Enemy_Template> enemy_templates;
+// flat [type][state] table, enemy_state_count rows per type
+extern std::vector<Enemy_Transition> enemy_transitions;
 
-	false,	// flipped?
-	vec2(18, 22),	// actual size
-	vec2(0, 0),		// collision offset
+// fills enemy_templates and enemy_transitions from enemies.json
+void load_enemy_types();
 
-	0.85f * BASE_TILE_SIZE_HEIGHT / 22, // RELATIVE_SIZE
-	vec2(100, 100), // SPRITE_SIZE
-	100.0f,			// max_health
-	100.0f,			// current_health
-	25.0f,			// attack
-	0.0f,			// defense
-	0.0f,			// special_attack
-	0.0f,			// crit_rate
-	0.0f,			// crit_damage
-	0.0f			// invincible time
-};
-
-static Enemy_Template ranged_template = {
-	BASE_TILE_SIZE_HEIGHT * 1.5f,	// speed
-	500.f,							// windup time
-	150.f,							// attack time
-	500.f,							// recovery time
-	5,								// souls
-	1,								// health drops
-	BASE_TILE_SIZE_HEIGHT * 5.0f,	// range
-
-	textures_path("enemies/golem.png"),
-
-	0,	// texture handle
-	std::array<std::vector<TextureCoords>, enemy_state_count>(), // Dynamic because there is a dynamic number of animations. Could be hard-coded.
-
-	false,	// flipped?
-	vec2(25, 25),	// actual size
-	vec2(0, 0),		// collision offset
-
-	0.75f * (BASE_TILE_SIZE_HEIGHT / 25), // RELATIVE_SIZE
-	vec2(64, 64), // SPRITE_SIZE
-	70.0f,			// max_health
-	70.0f,			// current_health
-	5.0f,			// attack
-	0.0f,			// defense
-	20.0f,			// special_attack
-	0.0f,			// crit_rate
-	0.0f,			// crit_damage
-	0.0f			// invincible time
-};
-
-static Enemy_Template boss_template = {
-	BASE_TILE_SIZE_HEIGHT * 0.5f,	// speed
-	500.f,							// windup time
-	150.f,							// attack time
-	500.f,							// recovery time
-	5,								// souls
-	5,							// health drops
-	BASE_TILE_SIZE_HEIGHT * 5.0f,	// range
-
-	textures_path("enemies/golem.png"),
-
-	0,	// texture handle
-	std::array<std::vector<TextureCoords>, enemy_state_count>(), // Dynamic because there is a dynamic number of animations. Could be hard-coded.
-
-	false,	// flipped?
-	vec2(25, 25),	// actual size
-	vec2(0, 0),		// collision offset
-
-	2.0f * (BASE_TILE_SIZE_HEIGHT / 25), // RELATIVE_SIZE
-	vec2(64, 64),	// SPRITE_SIZE
-	800.0f,			// max_health
-	800.0f,			// current_health
-	10.0f,			// attack
-	5.0f,			// defense
-	10.0f,			// special_attack
-	.05f,			// crit_rate
-	2.0f,			// crit_damage
-	0.0f			// invincible time
-};
-
-static std::map<ENEMY_TYPE, Enemy_Template> enemy_templates = {
-	{DEBUG_ENEMY, debug_template},
-	{CHARGER, charger_template},
-	{RANGED, ranged_template},
-	{BOSS, boss_template}
-};
+inline const Enemy_Transition& get_enemy_transition(int type, ENEMY_STATES state) {
+	return enemy_transitions[type * enemy_state_count + (int)state];
+}
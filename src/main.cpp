@@ -16,6 +16,16 @@
 #include "util/map_parser.hpp"
 #include "util/screen_manager.hpp"
 #include "systems/particle_system.hpp"
+#include "util/benchmark.hpp"
+#include "util/frame_profiler.hpp"
+#include "util/map_compiler.hpp"
+#include "util/job_graph.hpp"
+#include "util/asset_pack.hpp"
+#include "util/fixed_timestep.hpp"
+#include "util/system_scheduler.hpp"
+#include "systems/tick_systems.hpp"
+#include "util/render_thread.hpp"
+#include "util/rng.hpp"
 
 // imgui
 #include "../ext/imgui/imgui.h"
@@ -25,8 +35,63 @@
 using Clock = std::chrono::high_resolution_clock;
 
 // Entry point
-int main()
+int main(int argc, char* argv[])
 {
+	// command line benchmarks run without opening a window
+	if (Benchmark::run_from_args(argc, argv)) {
+		return EXIT_SUCCESS;
+	}
+	int exit_code = EXIT_SUCCESS;
+	if (MapCompiler::run_from_args(argc, argv, exit_code)) {
+		return exit_code;
+	}
+	if (AssetPacker::run_from_args(argc, argv, exit_code)) {
+		return exit_code;
+	}
+
+	// optional, without it every asset is read from data/ as before
+	if (asset_pack.open(AssetPack::pack_path())) {
+		std::cout << "Using asset pack " << AssetPack::pack_path() << std::endl;
+	}
+
+	// load testing: --horde <count> keeps that many enemies in the room, --profile prints a per-system frame breakdown
+	// --tick-rate <ticks per second> sets the simulation rate, independent of the frame rate
+	// --render-thread draws the play screen on its own thread, overlapping with the next frame's simulation
+	// --seed <number> replays the random rolls of an earlier game, --deterministic also runs exactly one
+	// tick per frame and takes timing out of the AI, so the same seed and input give the same game
+	unsigned int horde_size = 0;
+	bool use_render_thread = false;
+	bool deterministic = false;
+	FixedTimestep timestep;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--horde" && i + 1 < argc) {
+			horde_size = (unsigned int)std::stoi(argv[++i]);
+			frame_profiler.enabled = true;
+		}
+		else if (arg == "--profile") {
+			frame_profiler.enabled = true;
+		}
+		else if (arg == "--tick-rate" && i + 1 < argc) {
+			float tick_rate = std::stof(argv[++i]);
+			// a tick length of 0 would never run a tick and freeze the game
+			if (tick_rate <= 0.f) {
+				std::cerr << "ERROR: --tick-rate must be above 0" << std::endl;
+				return EXIT_FAILURE;
+			}
+			timestep.set_tick_rate(tick_rate);
+		}
+		else if (arg == "--render-thread") {
+			use_render_thread = true;
+		}
+		else if (arg == "--seed" && i + 1 < argc) {
+			rng.seed(std::stoull(argv[++i]));
+		}
+		else if (arg == "--deterministic") {
+			deterministic = true;
+		}
+	}
+
 	// global systems
 	AISystem	  	ai_system;
 	WorldSystem   	world_system;
@@ -39,6 +104,8 @@ int main()
 	ParticleSystem	particle_system;
 	UpgradeSystem   upgrade_system;
 	ScreenManager 	screen_manager(&renderer_system, &world_system, &upgrade_system);
+	ai_system.deterministic = deterministic;
+	std::cout << "Random seed " << rng.get_seed() << std::endl;
 
 	// initialize window
 	GLFWwindow* window = world_system.create_window();
@@ -49,30 +116,69 @@ int main()
 		return EXIT_FAILURE;
 	}
 
-	if (!world_system.start_and_load_sounds()) {
-		std::cerr << "ERROR: Failed to start or load sounds." << std::endl;
+	// initialize the main systems: sounds, glyphs and images load on workers, GL and SDL init stay on this thread
+	JobGraph startup;
+	bool audio_started = false;
+	int audio = startup.add_main("audio init", [&]() {
+		audio_started = world_system.start_audio();
+	});
+	int sounds = startup.add("sounds", [&]() {
+		if (!audio_started || !world_system.load_sounds()) {
+			std::cerr << "ERROR: Failed to start or load sounds." << std::endl;
+		}
+	}, { audio });
+	int glyphs = startup.add("glyphs", [&]() {
+		renderer_system.rasterizeFonts();
+	});
+	int renderer = startup.add_main("renderer", [&]() {
+		renderer_system.init(window);
+	});
+	int fonts = startup.add_main("fonts", [&]() {
+		renderer_system.fontInit(window);
+	}, { renderer, glyphs });
+	int imgui = startup.add_main("imgui", [&]() {
+		renderer_system.initImGui(window);
+	}, { renderer });
+	// the systems only acquire texture handles here, their images decode on the workers in the meantime
+	int systems = startup.add_main("systems", [&]() {
+		player_system.init(renderer_system);
+		enemy_system.init(renderer_system);
+		item_system.init(renderer_system);
+		upgrade_system.init(renderer_system);
+		particle_system.init(renderer_system);
+		ai_system.init(&enemy_system);
+	}, { renderer });
+	int textures = startup.add_main("texture uploads", [&]() {
+		renderer_system.endTextureBatch();
+	}, { systems });
+	startup.add_main("world", [&]() {
+		world_system.init(&renderer_system, &player_system, &enemy_system, &item_system, &screen_manager, &upgrade_system, &particle_system, &ai_system);
+		world_system.set_horde_size(horde_size);
+	}, { sounds, fonts, imgui, textures });
+	startup.run();
+	startup.print_timings("Startup");
+
+	// systems of one simulation tick, see tick_systems.cpp
+	SystemScheduler tick_systems;
+	add_tick_systems(tick_systems, world_system, player_system, ai_system, enemy_system, item_system, animation_system, physics_system, particle_system);
+	if (frame_profiler.enabled) {
+		tick_systems.print_graph();
 	}
 
-	// initialize the main systems
-	renderer_system.init(window);
-	renderer_system.fontInit(window);
-	renderer_system.initImGui(window);
-	player_system.init(renderer_system);
-	enemy_system.init(renderer_system);
-	item_system.init(renderer_system);
-	upgrade_system.init(renderer_system);
-	particle_system.init(renderer_system);
-	ai_system.init(&enemy_system);
-	world_system.init(&renderer_system, &player_system, &enemy_system, &item_system, &screen_manager, &upgrade_system, &particle_system, &ai_system);
-
 	//map_loader.parseMaps(textures_path("map/city_0.json"), &renderer_system);
 
-	// variable timestep loop
+	if (use_render_thread) {
+		render_thread.start(window, [&](const RenderSnapshot& snapshot) { renderer_system.drawSnapshot(snapshot); });
+	}
+
+	// fixed timestep loop: the simulation runs in ticks of timestep.tick_ms(), rendering as often as it can
 	auto t = Clock::now();
 	while (!world_system.is_over()) {
 		
 		// processes system messages, if this wasn't present the window would become unresponsive
 		glfwPollEvents();
+		// edited shaders are swapped in here, between frames
+		renderer_system.reloadChangedShaders();
 
 		// calculate elapsed times in milliseconds from the previous iteration
 		auto now = Clock::now();
@@ -80,28 +186,36 @@ int main()
 			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
 		t = now;
 
-		float elapsed_ms = actual_elapsed_ms;
-
-		if (actual_elapsed_ms > 33.3) {
-			elapsed_ms = 33.3;
+		frame_profiler.begin_frame();
+
+		bool playing = screen_manager.getCurrentScreen() == ScreenType::PlayScreen || screen_manager.getCurrentScreen() == ScreenType::TutorialScreen;
+		if (playing) {
+			world_system.update_fps(actual_elapsed_ms);
+
+			int ticks = deterministic ? 1 : timestep.advance(actual_elapsed_ms);
+			for (int tick = 0; tick < ticks; tick++) {
+				timestep.begin_tick();
+				tick_systems.run(timestep.tick_ms());
+			}
+			// wall time of the ticks, the systems above are charged their own time and may overlap
+			frame_profiler.mark("simulation");
+			// a deterministic frame is exactly one tick, there is nothing to blend
+			if (!deterministic) {
+				timestep.apply_interpolation();
+			}
 		}
-
-		if (screen_manager.getCurrentScreen() == ScreenType::PlayScreen || screen_manager.getCurrentScreen() == ScreenType::TutorialScreen) {
-			// CK: be mindful of the order of your systems and rearrange this list only if necessary
-			animation_system.step(elapsed_ms); // Update animations before anything else.
-											// This lets any further changes to animation happen immediately
-			world_system.step(elapsed_ms, actual_elapsed_ms);
-			player_system.step(elapsed_ms);
-			ai_system.step(elapsed_ms);
-			enemy_system.step(elapsed_ms);
-			item_system.step(elapsed_ms);
-			physics_system.step(elapsed_ms);
-			particle_system.step(elapsed_ms);
-			world_system.handle_collisions();
+		else {
+			// nothing to catch up on after a pause or menu
+			timestep.reset();
 		}
 
+		// includes the buffer swap, so this also absorbs vsync waits. With the render thread it only
+		// captures the frame and waits for the previous one to be picked up
 		screen_manager.renderScreen();
+		timestep.restore_simulation();
+		frame_profiler.mark("render");
 		screen_manager.handleInput(window);
+		frame_profiler.end_frame();
 
 	}
 
@@ -2,8 +2,16 @@
 #include "ai_system.hpp"
 #include "world_init.hpp"
 #include <cmath>
-#include <set>
-#include <queue>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <chrono>
+#include "../util/spatial_grid.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+// the spatial grid is rebuilt after physics, so pad queries by how far entities may have moved since
+const float AI_QUERY_MARGIN = BASE_TILE_SIZE_WIDTH;
 
 float AISystem::ms_since_last_pathfind;
 
@@ -100,14 +108,14 @@ float distance(vec2 point1, vec2 point2) {
 // any edge in given graph
 // assumes that the graph has at least 3 nodes and each node has at least
 // 2 edges each
-bool AISystem::intersects_with_graph(vec2 pos_a, vec2 pos_b, PathNode* graph, std::set<PathNode*> ignore_set) {
+bool AISystem::intersects_with_graph(vec2 pos_a, vec2 pos_b, PathNode* graph) {
 	PathNode* currentNode = graph;
 	PathNode* lastNode = nullptr;
 	assert(currentNode->edges.size() > 1 && "PathNode has less than 2 edges");
 	do {
 		size_t i = 0;
 		PathNode* nextNode = currentNode->edges[i];
-		while (nextNode == lastNode || ignore_set.find(nextNode) != ignore_set.end()) {
+		while (nextNode == lastNode || (nextNode != nullptr && nextNode->ignored)) {
 			i += 1;
 			nextNode = currentNode->edges[i];
 		}
@@ -121,6 +129,16 @@ bool AISystem::intersects_with_graph(vec2 pos_a, vec2 pos_b, PathNode* graph, st
 	return false;
 }
 
+// returns true if nothing blocks the line between pos_a and pos_b
+// uses a raycast over the navigation grid when one is loaded, otherwise
+// falls back to testing the segment against every edge of graph
+bool AISystem::is_segment_clear(vec2 pos_a, vec2 pos_b, PathNode* graph) {
+	if (!nav_grid.empty()) {
+		return nav_grid.has_line_of_sight(pos_a, pos_b);
+	}
+	return !intersects_with_graph(pos_a, pos_b, graph);
+}
+
 // assumes b exists in a.edges, and a exists in b.edges
 PathNode* AISystem::unlink_nodes(PathNode* a, PathNode* b) {
 	if (a == nullptr || b == nullptr) {
@@ -168,10 +186,11 @@ PathNode* AISystem::create_pathNode(vec2 pos/*, int node_id, int node_to_connect
 }
 
 // update position of an entity's PathNode and update edges 
-PathNode* AISystem::update_node_position_edges(PathNode* node, vec2 pos, PathNode* graph, std::set<PathNode*> ignore_set) {
+PathNode* AISystem::update_node_position_edges(PathNode* node, vec2 pos, PathNode* graph) {
 	node->position = pos;
-	for (PathNode* linkedNode : node->edges) {
-		unlink_nodes(node, linkedNode);
+	// unlink_nodes erases from node->edges, so always unlink the last edge
+	while (node->edges.size() > 0) {
+		unlink_nodes(node, node->edges.back());
 	}
 	PathNode* currentNode = graph;
 	if (currentNode == nullptr) {
@@ -179,13 +198,13 @@ PathNode* AISystem::update_node_position_edges(PathNode* node, vec2 pos, PathNod
 	}
 	PathNode* lastNode = nullptr;
 	do {
-		if (!intersects_with_graph(node->position, currentNode->position, graph, ignore_set)) {
+		if (is_segment_clear(node->position, currentNode->position, graph)) {
 			//std::cerr << "No intersection";
 			link_nodes(node, currentNode);
 		}
 		size_t i = 0;
 		PathNode* nextNode = currentNode->edges[i];
-		while (nextNode == lastNode || ignore_set.find(nextNode) != ignore_set.end()) {
+		while (nextNode == lastNode || (nextNode != nullptr && nextNode->ignored)) {
 			nextNode = currentNode->edges[++i];
 		}
 		lastNode = currentNode;
@@ -196,71 +215,87 @@ PathNode* AISystem::update_node_position_edges(PathNode* node, vec2 pos, PathNod
 }
 
 // returns a pointer to a PathNode at pos, connected to graph, associated with Entity
-PathNode* AISystem::add_position_to_graph(Entity& entity, vec2 pos, PathNode* graph, std::set<PathNode*> ignore_set) {
+// entity nodes are flagged as ignored so obstacle graph walks never step onto them
+PathNode* AISystem::add_position_to_graph(Entity& entity, vec2 pos, PathNode* graph) {
 	PathNode* newNode = new PathNode();
+	newNode->ignored = true;
 	registry.pathNodes.emplace(entity, newNode);
-	update_node_position_edges(newNode, pos, graph, ignore_set);
+	update_node_position_edges(newNode, pos, graph);
 	return newNode;
 }
 
 // Give player a pathNode if they don't have one, update its pos and edges
-void AISystem::update_player_pathnode_edges() {
-	Entity& player_entity = registry.players.entities[0];
-	vec2& position = registry.positions.get(player_entity).position;
-	ComponentContainer<PathNode*>& pathNode_registry = registry.pathNodes;
-	ComponentContainer<PathNode*>& pathGraph_registry = registry.pathGraphs;
-	std::set<PathNode*> ignore_set;
-	for (Entity& enemy_entity : registry.enemies.entities) {
-		if (!registry.positions.has(enemy_entity)) continue;
-		if (pathNode_registry.has(enemy_entity)) {
-			ignore_set.insert(pathNode_registry.get(enemy_entity));
-		}
-	}
+void AISystem::update_player_pathnode_edges(AIContext& ctx) {
 	PathNode* player_pathNode = nullptr;
-	if (pathNode_registry.has(player_entity)) {
-		player_pathNode = pathNode_registry.get(player_entity);
+	if (ctx.pathNodes.has(ctx.player_entity)) {
+		player_pathNode = ctx.pathNodes.get(ctx.player_entity);
 	}
 	else {
-		player_pathNode = add_position_to_graph(player_entity, position, nullptr, ignore_set);
+		player_pathNode = add_position_to_graph(ctx.player_entity, ctx.player_position, nullptr);
 	}
-	ignore_set.insert(player_pathNode);
-	for (PathNode* graph : pathGraph_registry.components) {
-		update_node_position_edges(player_pathNode, position, graph, ignore_set);
+	for (PathNode* graph : registry.pathGraphs.components) {
+		update_node_position_edges(player_pathNode, ctx.player_position, graph);
 	}
 }
 
-// BFS implementation. 
-// todo: save path and use it as basis for new search instead of starting from scratch
+// A* search over the PathNode graph, using straight line distance as the heuristic.
+// Returns the position of the first node after start on the shortest path to end,
+// or start's position if end cannot be reached.
+// Per-node costs and parents are stored on the nodes and invalidated by bumping
+// search_id, so nothing has to be cleared between searches.
 vec2& AISystem::search_path_graph(PathNode* start, PathNode* end) {
-	std::queue<std::vector<PathNode*>> paths_to_search;
-	std::vector<PathNode*> starting_path;
-	starting_path.push_back(start);
-	paths_to_search.push(starting_path);
-	while (paths_to_search.size() > 0) {
-		std::vector<PathNode*> path_to_continue = paths_to_search.front();
-		PathNode* lookup_node = path_to_continue.back();
-		std::vector<PathNode*> edges_to_check = lookup_node->edges;
-		for (PathNode* nextNode : edges_to_check) {
-			bool onPath = false;
-			for (PathNode* pathNode : path_to_continue) {
-				if (pathNode == nextNode) {
-					onPath = true;
-					break;
-				}
+	if (start == end) {
+		return start->position;
+	}
+	search_id++;
+	open_set.clear();
+
+	start->search_id = search_id;
+	start->cost_so_far = 0.f;
+	start->came_from = nullptr;
+	start->closed = false;
+	open_set.push_back({ distance(start->position, end->position), start });
+
+	// open_set is kept as a min-heap on estimated total cost
+	auto greater_cost = std::greater<std::pair<float, PathNode*>>();
+	while (open_set.size() > 0) {
+		std::pop_heap(open_set.begin(), open_set.end(), greater_cost);
+		PathNode* current = open_set.back().second;
+		open_set.pop_back();
+
+		// a node can be pushed more than once, skip entries that were already expanded
+		if (current->closed) {
+			continue;
+		}
+		current->closed = true;
+
+		if (current == end) {
+			// walk the parent pointers back to the node right after start
+			PathNode* step = end;
+			while (step->came_from != start) {
+				step = step->came_from;
 			}
-			if (onPath) {
-				continue;
+			return step->position;
+		}
+
+		for (PathNode* next : current->edges) {
+			if (next->search_id != search_id) {
+				next->search_id = search_id;
+				next->cost_so_far = std::numeric_limits<float>::infinity();
+				next->came_from = nullptr;
+				next->closed = false;
 			}
-			else if (nextNode == end) {
-				return path_to_continue[1]->position;
+			if (next->closed) {
+				continue;
 			}
-			else {
-				std::vector<PathNode*> newPath(path_to_continue);
-				newPath.push_back(nextNode);
-				paths_to_search.push(newPath);
+			float cost = current->cost_so_far + distance(current->position, next->position);
+			if (cost < next->cost_so_far) {
+				next->cost_so_far = cost;
+				next->came_from = current;
+				open_set.push_back({ cost + distance(next->position, end->position), next });
+				std::push_heap(open_set.begin(), open_set.end(), greater_cost);
 			}
 		}
-		paths_to_search.pop();
 	}
 	return start->position;
 }
@@ -268,46 +303,32 @@ vec2& AISystem::search_path_graph(PathNode* start, PathNode* end) {
 // [5] Random / Coded Action
 // Returns moveNode corresponding to the next step in the 
 // shortest path from Entity to Player
-MoveNode& AISystem::get_path_to_player(Entity& entity) {
-	ComponentContainer<Position> position_registry = registry.positions;
-	vec2& position = position_registry.get(entity).position;
-	Entity& player_entity = registry.players.entities[0];
-	vec2& player_position = position_registry.get(player_entity).position;
-
-	ComponentContainer<MoveNode>& moveNode_registry = registry.moveNodes;
-	if (moveNode_registry.has(entity)) {
-		moveNode_registry.remove(entity);
-	}
-	MoveNode& new_node = moveNode_registry.emplace(entity);
-
-	// ignore_set is populated with all pathnodes belonging to enemies and the player
-	// prevents intersection checking from including their edges in its algorithm
-	std::set<PathNode*> ignore_set;
-	for (Entity& enemy_entity : registry.enemies.entities) {
-		if (!registry.positions.has(enemy_entity)) continue;
-		if (registry.pathNodes.has(enemy_entity) && enemy_entity != entity) {
-			ignore_set.insert(registry.pathNodes.get(enemy_entity));
-		}
+MoveNode& AISystem::get_path_to_player(AIContext& ctx, Entity& entity) {
+	vec2& position = ctx.positions.get(entity).position;
+	vec2& player_position = ctx.player_position;
+
+	if (!ctx.moveNodes.has(entity)) {
+		ctx.moveNodes.emplace(entity);
 	}
-	ignore_set.insert(registry.pathNodes.get(player_entity));
+	MoveNode& new_node = ctx.moveNodes.get(entity);
 
 	// If a line segment from Entity to Player does not intersect with a map obstacle edge
 	// bypass the search and set Entity's movenode to the Player's position.
 	for (PathNode* graph : registry.pathGraphs.components) {
-		if (intersects_with_graph(position, player_position, graph, ignore_set)) {
+		if (!is_segment_clear(position, player_position, graph)) {
 			//std::cerr << "Intersection detected \n";
 			PathNode* pathNode;
 			// if the entity does not have a pathNode, give it one.
 			// in either case, update its edges with map obstacle pathNodes.
-			if (registry.pathNodes.has(entity)) {
-				pathNode = update_node_position_edges(registry.pathNodes.get(entity), position, graph, ignore_set);
+			if (ctx.pathNodes.has(entity)) {
+				pathNode = update_node_position_edges(ctx.pathNodes.get(entity), position, graph);
 			}
 			else {
-				pathNode = add_position_to_graph(entity, position, graph, ignore_set);
+				pathNode = add_position_to_graph(entity, position, graph);
 			}
 
-			// BFS called here
-			new_node.position = search_path_graph(pathNode, registry.pathNodes.get(player_entity));
+			// A* called here
+			new_node.position = search_path_graph(pathNode, ctx.pathNodes.get(ctx.player_entity));
 			return new_node;
 		}
 	}
@@ -316,75 +337,253 @@ MoveNode& AISystem::get_path_to_player(Entity& entity) {
 	return new_node;
 }
 
-// placeholder behavior
-// simply sets sees_player to "true" for all enemies
-void AISystem::check_vision() {
-	ComponentContainer<Position> position_registry = registry.positions;
-	Entity& player_entity = registry.players.entities[0];
-	vec2& player_position = position_registry.get(player_entity).position;
-	for (Entity& entity : registry.enemies.entities) {
-		if (!registry.positions.has(entity)) continue;
-		Enemy& enemy = registry.enemies.get(entity);
-		vec2& position = position_registry.get(entity).position;
-		if (distance(position, player_position) < BASE_TILE_SIZE_HEIGHT * 12.f){
-			enemy.sees_player = true;
+// Dijkstra from the player's cell over nav_grid. Afterwards flow_next of every reachable
+// cell points one step closer to the player, so each enemy can read its next step in O(1)
+// instead of running its own search. Only rebuilt when the player changes cell.
+void AISystem::build_flow_field(AIContext& ctx) {
+	if (nav_grid.empty()) {
+		return;
+	}
+	int target = nav_grid.cell_of(ctx.player_position);
+	if (target == flow_target_cell) {
+		return;
+	}
+	flow_target_cell = target;
+	flow_cost.assign(nav_grid.width * nav_grid.height, std::numeric_limits<float>::infinity());
+	flow_next.assign(nav_grid.width * nav_grid.height, -1);
+	if (target < 0) {
+		return;
+	}
+
+	flow_open_set.clear();
+	flow_cost[target] = 0.f;
+	flow_open_set.push_back({ 0.f, target });
+	auto greater_cost = std::greater<std::pair<float, int>>();
+	while (flow_open_set.size() > 0) {
+		std::pop_heap(flow_open_set.begin(), flow_open_set.end(), greater_cost);
+		std::pair<float, int> current = flow_open_set.back();
+		flow_open_set.pop_back();
+		if (current.first > flow_cost[current.second]) {
+			continue;
 		}
-		else {
-			enemy.sees_player = false;
+		int x = current.second % nav_grid.width;
+		int y = current.second / nav_grid.width;
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if ((dx == 0 && dy == 0) || nav_grid.is_blocked(x + dx, y + dy)) {
+					continue;
+				}
+				// diagonal steps may not cut the corner of a blocked tile
+				if (dx != 0 && dy != 0 && (nav_grid.is_blocked(x + dx, y) || nav_grid.is_blocked(x, y + dy))) {
+					continue;
+				}
+				int next = nav_grid.index(x + dx, y + dy);
+				float cost = current.first + ((dx != 0 && dy != 0) ? 1.41421356f : 1.f);
+				if (cost < flow_cost[next]) {
+					flow_cost[next] = cost;
+					flow_next[next] = current.second;
+					flow_open_set.push_back({ cost, next });
+					std::push_heap(flow_open_set.begin(), flow_open_set.end(), greater_cost);
+				}
+			}
 		}
-		
 	}
 }
 
-// [5] Random/Coded Action
-// First updates the player pathnode's connections to existing graphs
-// Then tells all enemies who can see the player to get a path
-void AISystem::find_paths() {
-	if (registry.players.size() > 0) {
-		update_player_pathnode_edges();
-		for (Entity& enemy_entity : registry.enemies.entities) {
-			if (!registry.positions.has(enemy_entity)) continue;
-
-			Enemy& enemy_component = registry.enemies.get(enemy_entity);
-			if (enemy_component.sees_player && (enemy_component.current_state == ENEMY_IDLE || enemy_component.current_state == ENEMY_WALKING)) {
-				get_path_to_player(enemy_entity);
-			}
+// Points a chasing enemy's moveNode at the center of the next cell in the flow field.
+// Enemies with a clear line to the player, in or next to the player's cell, or in cells
+// the field does not reach, head straight for the player.
+void AISystem::follow_flow_field(AIContext& ctx, Entity& enemy_entity) {
+	vec2& player_position = ctx.player_position;
+	vec2 target = player_position;
+	vec2& position = ctx.positions.get(enemy_entity).position;
+	int cell = nav_grid.empty() ? -1 : nav_grid.cell_of(position);
+	if (cell >= 0 && cell != flow_target_cell && flow_next.size() > 0 && !nav_grid.has_line_of_sight(position, player_position)) {
+		int next = flow_next[cell];
+		if (next >= 0 && next != flow_target_cell) {
+			target = nav_grid.cell_center(next);
+		}
+	}
+
+	if (!ctx.moveNodes.has(enemy_entity)) {
+		ctx.moveNodes.emplace(enemy_entity);
+	}
+	ctx.moveNodes.get(enemy_entity).position = target;
+}
+
+// Posts a background search for the enemy and steers it with the latest finished waypoint,
+// which arrives a frame or more after the request (right away in deterministic mode). Enemies
+// with a clear line to the player skip the search and head straight for them.
+void AISystem::follow_async_path(AIContext& ctx, Entity& enemy_entity) {
+	vec2& position = ctx.positions.get(enemy_entity).position;
+	vec2 target = ctx.player_position;
+	if (!nav_grid.empty() && !nav_grid.has_line_of_sight(position, ctx.player_position)) {
+		if (deterministic) {
+			target = PathService::find_waypoint(nav_grid, position, ctx.player_position);
+		}
+		else {
+			path_service.request(enemy_entity, position, ctx.player_position);
+			path_service.get_waypoint(enemy_entity, target);
 		}
 	}
+
+	if (!ctx.moveNodes.has(enemy_entity)) {
+		ctx.moveNodes.emplace(enemy_entity);
+	}
+	ctx.moveNodes.get(enemy_entity).position = target;
 }
 
-bool AISystem::player_in_range(Entity& enemy_entity) {
-	Enemy& enemy_component = registry.enemies.get(enemy_entity);
-	ComponentContainer<Position>& position_reg = registry.positions;
-	vec2& enemy_position = position_reg.get(enemy_entity).position;
-	vec2& player_position = position_reg.get(registry.players.entities[0]).position;
-	//std::cerr << "distance: " << distance(enemy_position, player_position) << "versus range: " << enemy_component.attack_range << "\n";
-	return (distance(enemy_position, player_position) <= enemy_component.attack_range);
+// An enemy spots the player when they are within 12 tiles and no wall blocks the line
+// between them. Once spotted, the enemy keeps tracking the player while they stay in range,
+// so chasers follow the player around corners instead of forgetting them.
+void AISystem::update_vision(AIContext& ctx, Entity& entity) {
+	Enemy& enemy = ctx.enemies.get(entity);
+	vec2& position = ctx.positions.get(entity).position;
+	if (distance(position, ctx.player_position) >= BASE_TILE_SIZE_HEIGHT * 12.f) {
+		enemy.sees_player = false;
+	}
+	else if (!enemy.sees_player) {
+		enemy.sees_player = nav_grid.empty() || nav_grid.has_line_of_sight(position, ctx.player_position);
+	}
+}
+
+// Perception and pathing for a single enemy
+void AISystem::update_enemy(AIContext& ctx, Entity& enemy_entity) {
+	update_vision(ctx, enemy_entity);
+	Enemy& enemy_component = ctx.enemies.get(enemy_entity);
+	if (!enemy_component.sees_player || (enemy_component.current_state != ENEMY_IDLE && enemy_component.current_state != ENEMY_WALKING)) {
+		return;
+	}
+	if (pathing_mode == PATHING_FLOW_FIELD) {
+		follow_flow_field(ctx, enemy_entity);
+	}
+	else if (pathing_mode == PATHING_ASYNC_GRID) {
+		follow_async_path(ctx, enemy_entity);
+	}
+	else {
+		get_path_to_player(ctx, enemy_entity);
+	}
 }
 
-void AISystem::check_attacks() {
-	if (registry.players.size() > 0) {
-		Position& player_pos = registry.positions.get(registry.players.entities[0]);
-		for (Entity& enemy_entity : registry.enemies.entities) {
-			if (!registry.positions.has(enemy_entity)) continue;
+// Spreads per-enemy updates over frames instead of updating everyone at once.
+// An enemy is due every AI_PRIORITY_UPDATE_MS when walking or near the player, otherwise every
+// AI_PATHFINDING_INTERVAL_MS. Due priority enemies are served first, then whatever is left of
+// AI_FRAME_BUDGET_US (or of AI_DETERMINISTIC_UPDATES updates) goes to the other due enemies.
+// Each pass walks round-robin from where it stopped last frame, so the enemies that missed out
+// are first in line next frame.
+void AISystem::run_scheduled_updates(AIContext& ctx, float elapsed_ms) {
+	size_t count = ctx.enemies.size();
+	if (count == 0) {
+		return;
+	}
+	for (Enemy& enemy : ctx.enemies.components) {
+		enemy.ms_since_ai_update += elapsed_ms;
+	}
 
-			Enemy& enemy_component = registry.enemies.get(enemy_entity);
-			if (enemy_component.current_state != ENEMY_IDLE && enemy_component.current_state != ENEMY_WALKING) {
+	auto start = Clock::now();
+	float priority_range = AI_PRIORITY_RANGE_TILES * BASE_TILE_SIZE_WIDTH;
+	int updates = 0;
+	// updates the due enemies, only the priority ones if priority_only, starting at cursor.
+	// Returns true once the budget is spent, with cursor just after the last enemy updated.
+	auto run_pass = [&](bool priority_only, size_t& cursor) {
+		if (cursor >= count) {
+			cursor = 0;
+		}
+		size_t first = cursor;
+		for (size_t visited = 0; visited < count; visited++) {
+			size_t i = (first + visited) % count;
+			Entity enemy_entity = ctx.enemies.entities[i];
+			if (!ctx.positions.has(enemy_entity)) continue;
+
+			Enemy& enemy = ctx.enemies.components[i];
+			bool priority = enemy.current_state == ENEMY_WALKING || distance(ctx.positions.get(enemy_entity).position, ctx.player_position) < priority_range;
+			if ((priority_only && !priority) || enemy.ms_since_ai_update < (priority ? AI_PRIORITY_UPDATE_MS : AI_PATHFINDING_INTERVAL_MS)) {
 				continue;
 			}
-			if (enemy_component.sees_player && player_in_range(enemy_entity)) {
-				//std::cerr << "player detected by enemy";
-				enemy_system->prepare_attack(enemy_entity, player_pos.position);
+			update_enemy(ctx, enemy_entity);
+			enemy.ms_since_ai_update = 0.f;
+
+			cursor = (i + 1) % count;
+			updates++;
+			bool over_budget;
+			if (deterministic) {
+				over_budget = updates >= AI_DETERMINISTIC_UPDATES;
+			}
+			else {
+				float elapsed_us = (float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+				over_budget = elapsed_us >= AI_FRAME_BUDGET_US;
+			}
+			if (over_budget) {
+				return true;
 			}
 		}
+		return false;
+	};
+	// priority enemies updated in the first pass are no longer due in the second
+	if (run_pass(true, next_priority_enemy)) {
+		return;
+	}
+	run_pass(false, next_enemy);
+}
+
+// Path data shared by every enemy, refreshed once per pathfinding interval: the flow field
+// toward the player, or the player pathnode's connections to the obstacle graphs
+void AISystem::update_shared_paths(AIContext& ctx) {
+	if (pathing_mode == PATHING_FLOW_FIELD) {
+		build_flow_field(ctx);
+	}
+	else if (pathing_mode == PATHING_GRAPH) {
+		update_player_pathnode_edges(ctx);
+	}
+}
+
+bool AISystem::player_in_range(AIContext& ctx, Entity& enemy_entity) {
+	Enemy& enemy_component = ctx.enemies.get(enemy_entity);
+	vec2& enemy_position = ctx.positions.get(enemy_entity).position;
+	//std::cerr << "distance: " << distance(enemy_position, ctx.player_position) << "versus range: " << enemy_component.attack_range << "\n";
+	return (distance(enemy_position, ctx.player_position) <= enemy_component.attack_range);
+}
+
+// runs every frame, attacks should not wait on the scheduler
+// only enemies the spatial grid places within attack range of the player are checked
+void AISystem::check_attacks(AIContext& ctx) {
+	nearby_entities.clear();
+	spatial_grid.query_radius(ctx.player_position, max_attack_range + AI_QUERY_MARGIN, nearby_entities);
+	for (Entity& enemy_entity : nearby_entities) {
+		if (!ctx.enemies.has(enemy_entity) || !ctx.positions.has(enemy_entity)) continue;
+
+		Enemy& enemy_component = ctx.enemies.get(enemy_entity);
+		if (enemy_component.current_state != ENEMY_IDLE && enemy_component.current_state != ENEMY_WALKING) {
+			continue;
+		}
+		if (!enemy_component.sees_player || !player_in_range(ctx, enemy_entity)) {
+			continue;
+		}
+		// don't attack through walls while tracking the player around a corner
+		if (nav_grid.empty() || nav_grid.has_line_of_sight(ctx.positions.get(enemy_entity).position, ctx.player_position)) {
+			//std::cerr << "player detected by enemy";
+			enemy_system->prepare_attack(enemy_entity, ctx.player_position);
+		}
 	}
 }
 
 void AISystem::step(float elapsed_ms)
 {
 	AISystem::ms_since_last_pathfind += elapsed_ms;
-	check_vision();
-	check_attacks();
+	if (registry.players.size() == 0) {
+		return;
+	}
+	// waypoints finished by the workers since last frame, without those of enemies killed since
+	path_service.collect();
+	path_service.forget_missing(registry.enemies.entities);
+	AIContext ctx = {
+		registry.positions,
+		registry.enemies,
+		registry.pathNodes,
+		registry.moveNodes,
+		registry.players.entities[0],
+		registry.positions.get(registry.players.entities[0]).position
+	};
 
 	// each node corresponds to a corner of the obstacle
 	// linking nodes creates an edge, corresponding to the sides of the obstacle
@@ -404,12 +603,29 @@ void AISystem::step(float elapsed_ms)
 	//	Entity graph_entity;
 	//	registry.pathGraphs.emplace(graph_entity, node0);
 	//}
-	if (AISystem::ms_since_last_pathfind >= AI_PATHFINDING_INTERVAL_MS) {
-		find_paths();
+	// a freshly loaded map has no flow field yet, and the player no pathnode to search toward, set them up right away
+	bool shared_paths_missing = (pathing_mode == PATHING_FLOW_FIELD && flow_next.size() == 0) ||
+		(pathing_mode == PATHING_GRAPH && !ctx.pathNodes.has(ctx.player_entity));
+	if (AISystem::ms_since_last_pathfind >= AI_PATHFINDING_INTERVAL_MS || shared_paths_missing) {
+		update_shared_paths(ctx);
 		AISystem::ms_since_last_pathfind = 0.f;
 	}
+	run_scheduled_updates(ctx, elapsed_ms);
+	check_attacks(ctx);
 }
 
 void AISystem::init(EnemySystem* enemy_system) {
 	this->enemy_system = enemy_system;
+	for (const Enemy_Template& enemy_template : enemy_templates) {
+		max_attack_range = max(max_attack_range, enemy_template.attack_range);
+	}
+}
+
+void AISystem::set_nav_grid(const NavGrid& grid) {
+	nav_grid = grid;
+	path_service.set_grid(grid);
+	// force the flow field to be rebuilt for the new map
+	flow_target_cell = -1;
+	flow_cost.clear();
+	flow_next.clear();
 }
\ No newline at end of file
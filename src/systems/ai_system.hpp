@@ -4,6 +4,26 @@
 #include "render_system.hpp"
 #include "../tinyECS/registry.hpp"
 #include "enemy_system.hpp"
+#include "../util/nav_grid.hpp"
+#include "../util/path_service.hpp"
+
+// how chasing enemies find their way to the player
+enum PATHING_MODE {
+	PATHING_FLOW_FIELD = 0,	// one search from the player shared by every enemy
+	PATHING_GRAPH,			// one search per enemy over the obstacle corner graphs
+	PATHING_ASYNC_GRID		// one grid search per enemy, run on the thread pool
+};
+
+// per-tick view of the registry shared by every AI pass, so containers and the
+// player are looked up once per step instead of once per enemy
+struct AIContext {
+	ComponentContainer<Position>& positions;
+	ComponentContainer<Enemy>& enemies;
+	ComponentContainer<PathNode*>& pathNodes;
+	ComponentContainer<MoveNode>& moveNodes;
+	Entity player_entity;
+	vec2 player_position;
+};
 
 class AISystem
 {
@@ -11,19 +31,55 @@ private:
 	static float ms_since_last_pathfind;
 	static int orientation(vec2 p, vec2 q, vec2 r);
 	static bool onSegment(vec2 p, vec2 q, vec2 r);
-	static bool intersects_with_graph(vec2 pos_a, vec2 pos_b, PathNode* graph, std::set<PathNode*> ignore_set);
+	static bool intersects_with_graph(vec2 pos_a, vec2 pos_b, PathNode* graph);
 
 	EnemySystem* enemy_system;
-	PathNode* update_node_position_edges(PathNode* node, vec2 pos, PathNode* graph, std::set<PathNode*> ignore_set);
-	MoveNode& get_path_to_player(Entity& entity);
-	PathNode* add_position_to_graph(Entity& entity, vec2 pos, PathNode* graph, std::set<PathNode*> ignore_set);
-	void update_player_pathnode_edges();
+
+	// scratch buffers reused by every search_path_graph call
+	std::vector<std::pair<float, PathNode*>> open_set;
+	unsigned int search_id = 0;
+
+	// flow field toward the player over nav_grid, flow_next holds the neighbouring cell
+	// to step into from each cell (-1 if the player cannot be reached from it)
+	NavGrid nav_grid;
+	std::vector<float> flow_cost;
+	std::vector<int> flow_next;
+	std::vector<std::pair<float, int>> flow_open_set;
+	int flow_target_cell = -1;
+
+	// background grid searches for PATHING_ASYNC_GRID
+	PathService path_service;
+
+	// longest attack range of any enemy type, bounds the attack query around the player
+	float max_attack_range = 0.f;
+	std::vector<Entity> nearby_entities;
+
+	// indices into registry.enemies where the scheduler's priority and round-robin passes resume next frame
+	size_t next_priority_enemy = 0;
+	size_t next_enemy = 0;
+
+	bool is_segment_clear(vec2 pos_a, vec2 pos_b, PathNode* graph);
+	PathNode* update_node_position_edges(PathNode* node, vec2 pos, PathNode* graph);
+	MoveNode& get_path_to_player(AIContext& ctx, Entity& entity);
+	PathNode* add_position_to_graph(Entity& entity, vec2 pos, PathNode* graph);
+	void update_player_pathnode_edges(AIContext& ctx);
 	vec2& search_path_graph(PathNode* start, PathNode* end);
-	void check_vision();
-	void check_attacks();
-	void find_paths();
-	bool player_in_range(Entity& enemy_entity);
+	void update_vision(AIContext& ctx, Entity& entity);
+	void check_attacks(AIContext& ctx);
+	void update_shared_paths(AIContext& ctx);
+	void update_enemy(AIContext& ctx, Entity& enemy_entity);
+	void run_scheduled_updates(AIContext& ctx, float elapsed_ms);
+	bool player_in_range(AIContext& ctx, Entity& enemy_entity);
+	void build_flow_field(AIContext& ctx);
+	void follow_flow_field(AIContext& ctx, Entity& enemy_entity);
+	void follow_async_path(AIContext& ctx, Entity& enemy_entity);
 public:
+	PATHING_MODE pathing_mode = PATHING_FLOW_FIELD;
+
+	// reproducible runs: nothing depends on timing, the scheduler stops after AI_DETERMINISTIC_UPDATES
+	// enemies instead of after AI_FRAME_BUDGET_US and PATHING_ASYNC_GRID searches run inline
+	bool deterministic = false;
+
 	void step(float elapsed_ms);
 
 	static bool does_intersect(vec2 p1, vec2 q1, vec2 p2, vec2 q2);
@@ -32,6 +88,9 @@ public:
 
 	void init(EnemySystem* enemy_system);
 
+	// called by MapLoader with the walkability grid of a freshly loaded map
+	void set_nav_grid(const NavGrid& grid);
+
 	static PathNode* link_nodes(PathNode* a, PathNode* b);
 	static PathNode* unlink_nodes(PathNode* a, PathNode* b);
 
@@ -2,13 +2,10 @@
 
 // [2] Sprite Animation
 void AnimationSystem::step(float elapsed_ms) {
-	auto& animation_registry = registry.animations;
-	for (int i = 0; i < animation_registry.size(); i++) {
-		Animation& animation = animation_registry.components[i];
-		Entity& entity = animation_registry.entities[i];
-
+	// handlers only advance their own animation (callbacks reset the single player's state)
+	registry.animations.parallel_for_each([elapsed_ms](Entity& entity, Animation& animation) {
 		animation_handlers[animation.type](entity, animation, elapsed_ms);
-	}
+	});
 }
 
 /*
@@ -1,6 +1,7 @@
 #include "enemy_system.hpp"
 #include "world_init.hpp"
 #include "../config.hpp"
+#include "../util/rng.hpp"
 #include <iostream>
 
 // Initializes enemy sprites and texture info
@@ -9,11 +10,12 @@ void EnemySystem::init(RenderSystem& renderer) {
 	// Load textures
 	//renderer.loadGlTextures(&enemy_handle, &SPRITE_PATH, 1);
 
-	renderer.loadGlTextures(&projectile_handle, &PROJECTILE_PATH, 1);
+	projectile_handle = renderer.acquireTexture(PROJECTILE_PATH);
 
-	for (int i = 0; i < enemy_type_count; i++) {
-		Enemy_Template& enemyTemplate = enemy_templates.at((ENEMY_TYPE)i);
-		renderer.loadGlTextures(&enemyTemplate.enemy_handle, &enemyTemplate.SPRITE_PATH, 1);
+	load_enemy_types();
+	for (int i = 0; i < (int)enemy_templates.size(); i++) {
+		Enemy_Template& enemyTemplate = enemy_templates[i];
+		enemyTemplate.enemy_handle = renderer.acquireTexture(enemyTemplate.SPRITE_PATH);
 
 		float vertical_size = 1.0f / enemy_animation_states;
 		float horizontal_size = 1.0f / MAX_ENEMY_ANIMATIONS;
@@ -27,28 +29,23 @@ void EnemySystem::init(RenderSystem& renderer) {
 			}
 		}
 	}
-
-	rng = std::default_random_engine(std::random_device()());
 }
 
 void EnemySystem::changeState(Entity e, ENEMY_STATES state) {
 	Enemy& enemy_component = registry.enemies.get(e);
 	Animation& a = registry.animations.get(e);
-	const Enemy_Template& enemyTemplate = enemy_templates.at(enemy_component.type);
 
 	assert(state < ENEMY_STATE_COUNT);
 
+	const Enemy_Transition& transition = get_enemy_transition(enemy_component.type, state);
 	enemy_component.current_state = state;
+	enemy_component.state_timer_ms = transition.duration_ms;
 	a.max_frames = num_enemy_animations[(int)state];
 	a.current_frame = 0; // reset frames
 
 	// Setup animation
 	switch (state) {
 	case ENEMY_FLINCH:
-		if (registry.attacks.has(e)) {
-			registry.attacks.remove(e);
-		}
-		enemy_component.flinch_timer_ms = 50.f;
 		a.type = LINEAR_ANIMATION;
 		a.info.la.animation_step = 200.0f; // 200 ms
 		a.info.la.animation_ms = 0.0f;
@@ -77,6 +74,27 @@ void EnemySystem::changeState(Entity e, ENEMY_STATES state) {
 		a.info.la.animation_ms = 0.0f;
 		break;
 	}
+
+	run_action(e, transition.on_enter);
+}
+
+void EnemySystem::run_action(Entity e, ENEMY_ACTION action) {
+	switch (action) {
+	case ENEMY_ACTION_ATTACK:
+		execute_attack(e);
+		break;
+	case ENEMY_ACTION_END_ATTACK:
+		registry.attacks.remove(e);
+		registry.velocities.get(e).velocity = vec2(0, 0);
+		break;
+	case ENEMY_ACTION_CANCEL_ATTACK:
+		if (registry.attacks.has(e)) {
+			registry.attacks.remove(e);
+		}
+		break;
+	default:
+		break;
+	}
 }
 
 // this function should be called when an enemy is damaged
@@ -97,7 +115,7 @@ void EnemySystem::react_to_parry(Entity& entity) {
 
 	Enemy& enemy_component = registry.enemies.get(entity);
 
-	enemy_component.flinch_timer_ms = PARRY_FLINCH_TIME;
+	enemy_component.state_timer_ms = PARRY_FLINCH_TIME;
 }
 
 void EnemySystem::updateTexture(Entity enemy_entity) {
@@ -109,7 +127,7 @@ void EnemySystem::updateTexture(Entity enemy_entity) {
 	// Set texture info
 	TextureInfo& ti = registry.textureinfos.get(enemy_entity);
 	Animation& a = registry.animations.get(enemy_entity);
-	const Enemy_Template& enemyTemplate = enemy_templates.at(enemy.type);
+	const Enemy_Template& enemyTemplate = enemy_templates[enemy.type];
 
 	pos.scale = flipped ? vec2(-enemyTemplate.SPRITE_SIZE.x, enemyTemplate.SPRITE_SIZE.y) : enemyTemplate.SPRITE_SIZE;
 	pos.scale = pos.scale * enemyTemplate.RELATIVE_SIZE;
@@ -166,21 +184,43 @@ void EnemySystem::updateMovement() {
 		MoveNode& moveNode = registry.moveNodes.get(entity);
 		Position& position = registry.positions.get(entity);
 		setVelocity(velocity, position.position, moveNode.position, speed);
+		velocity.velocity += separation(entity, position.position) * speed;
 		if (enemy.current_state == ENEMY_IDLE) {
 			changeState(entity, ENEMY_WALKING);
 		}
 	}
 }
 
+// sums pushes away from enemies closer than ENEMY_SEPARATION_RADIUS, stronger the closer they are,
+// so walking enemies spread out instead of stacking on the same path
+vec2 EnemySystem::separation(Entity entity, vec2 position) {
+	vec2 push = { 0.f, 0.f };
+	nearby_entities.clear();
+	spatial_grid.query_radius(position, ENEMY_SEPARATION_RADIUS, nearby_entities);
+	for (Entity& other : nearby_entities) {
+		if (other == entity || !registry.enemies.has(other)) {
+			continue;
+		}
+		vec2 offset = position - registry.positions.get(other).position;
+		float dist = length(offset);
+		if (dist < 0.001f) {
+			continue;
+		}
+		push += offset / dist * (1.f - dist / ENEMY_SEPARATION_RADIUS);
+	}
+	float push_length = length(push);
+	if (push_length > 1.f) {
+		push /= push_length;
+	}
+	return push * ENEMY_SEPARATION_WEIGHT;
+}
+
 // handles behavior for an enemy to prepare an attack and enter their "winding up" state
 void EnemySystem::prepare_attack(Entity& attacker, vec2& position) {
 	Enemy& enemy = registry.enemies.get(attacker);
-	const Enemy_Template& enemyTemplate = enemy_templates.at(enemy.type);
-	enemy.windup_timer_ms = enemyTemplate.windup_time_ms;
-	enemy.attack_timer_ms = enemyTemplate.attack_time_ms;
-	enemy.recovery_timer_ms = enemyTemplate.recovery_time_ms;
+	const Enemy_Template& enemyTemplate = enemy_templates[enemy.type];
 	changeState(attacker, ENEMY_WINDING_UP);
-	if (enemy.type == CHARGER || enemy.type == RANGED || enemy.type == BOSS) {
+	if (enemyTemplate.stops_to_attack) {
 		registry.moveNodes.remove(attacker);
 		registry.velocities.get(attacker).velocity = { 0, 0 };
 	}
@@ -193,36 +233,22 @@ void EnemySystem::prepare_attack(Entity& attacker, vec2& position) {
 
 // handles behavior for an enemy to execute their attack and enter their "attacking" state
 void EnemySystem::execute_attack(Entity& attacker) {
-	ComponentContainer<Attack>& attack_registry = registry.attacks;
-	ComponentContainer<Enemy>& enemy_registry = registry.enemies;
-	ComponentContainer<Position>& position_registry = registry.positions;
-	ComponentContainer<Velocity>& velocity_registry = registry.velocities;
-
-
-	Attack& attack_component = attack_registry.get(attacker);
-		
-	// if the attacking enemy is in attack state, give the attack a collision box and/or update
-	// the attack's position/size
-		
-	Enemy& enemy_component = enemy_registry.get(attacker);
-	Position& attacker_position = position_registry.get(attacker);
-	Velocity& attacker_velocity = velocity_registry.get(attacker);
-	float which_attack = 0;
-	switch (enemy_component.type) {
-	case CHARGER:
+	// a flinch during the windup already dropped the attack
+	if (!registry.attacks.has(attacker)) {
+		return;
+	}
+	const Enemy_Template& enemyTemplate = enemy_templates[registry.enemies.get(attacker).type];
+	if (enemyTemplate.attacks.size() == 0) {
+		return;
+	}
+	Attack& attack_component = registry.attacks.get(attacker);
+	const Enemy_Attack& enemy_attack = enemyTemplate.attacks[rng.below((int)enemyTemplate.attacks.size())];
+	switch (enemy_attack.kind) {
+	case ENEMY_ATTACK_CHARGE:
 		chargeAttack(attack_component);
 		break;
-	case RANGED:
-		projectileAttack(attack_component, 1);
-		break;
-	case BOSS:
-		which_attack = rand()%2;
-		if (which_attack > 0) {
-			projectileAttack(attack_component, 5);
-		}
-		else {
-			chargeAttack(attack_component);
-		}
+	case ENEMY_ATTACK_PROJECTILE:
+		projectileAttack(attack_component, enemy_attack.projectiles);
 		break;
 	default:
 		break;
@@ -236,66 +262,40 @@ void EnemySystem::chargeAttack(Attack& attack) {
 }
 
 void EnemySystem::projectileAttack(Attack& attack, int num_projectiles) {
-	Position& attacker_position = registry.positions.get(attack.attacker);
-	Velocity& attacker_velocity = registry.velocities.get(attack.attacker);
+	// createProjectile grows the attack and position containers, so copy what we need first
+	Entity attacker = attack.attacker;
+	vec2 attacker_position = registry.positions.get(attacker).position;
+	vec2 target_position = attack.target_position;
 	if (num_projectiles == 1) {
-		createProjectile(attack.attacker, attacker_position.position, attack.target_position, BASE_TILE_SIZE_HEIGHT * 8.0f,
+		createProjectile(attacker, attacker_position, target_position, BASE_TILE_SIZE_HEIGHT * 8.0f,
 			BASE_TILE_SIZE_HEIGHT * 2.0f, vec2(25.f, 25.f), 2, projectile_handle);
 	}
 	else {
-		float direction = atan2(attack.target_position.y,attack.target_position.x);
+		float direction = atan2(target_position.y,target_position.x);
 		//std::cerr << direction << std::endl;
 		for (double i = 0 - (double)num_projectiles / 2; i < (double)num_projectiles / 2; i += 1) {
-			vec2 target_pos = attack.target_position;
+			vec2 target_pos = target_position;
 			target_pos.y = target_pos.x * tan(direction + (i * 0.1));
-			createProjectile(attack.attacker, attacker_position.position, target_pos, BASE_TILE_SIZE_HEIGHT * 8.0f,
+			createProjectile(attacker, attacker_position, target_pos, BASE_TILE_SIZE_HEIGHT * 8.0f,
 				BASE_TILE_SIZE_HEIGHT * 2.0f, vec2(25.f, 25.f), 2, projectile_handle);
 		}
 	}
-	registry.attacks.remove(attack.attacker);
+	registry.attacks.remove(attacker);
 }
 
 
-// updates flinch timer for enemy damage reaction
-// updates attack timers for enemy attack behavior
+// counts down each enemy's state timer and takes the transition from its type's state table when it runs out
 void EnemySystem::updateTimers(float elapsed_ms) {
-	for (Entity& enemy_entity : registry.enemies.entities) {
-		Enemy& enemy = registry.enemies.get(enemy_entity);
-		if (enemy.flinch_timer_ms > 0) {
-			enemy.flinch_timer_ms -= elapsed_ms;
-		}
-		else if (enemy.flinch_timer_ms <= 0 && enemy.current_state == ENEMY_FLINCH) {
-			changeState(enemy_entity, ENEMY_IDLE);
-		}
-		// windup
-		else if (enemy.windup_timer_ms > 0) {
-			enemy.windup_timer_ms -= elapsed_ms;
-		}
-		else if (enemy.windup_timer_ms <= 0 && enemy.current_state == ENEMY_WINDING_UP) {
-			//std::cout << "Attack executing";
-			changeState(enemy_entity, ENEMY_ATTACKING);
-			// Create attack
-			execute_attack(enemy_entity);
-		}
-		// attack
-		else if (enemy.attack_timer_ms > 0) {
-			enemy.attack_timer_ms -= elapsed_ms;
-		}
-		else if (enemy.attack_timer_ms <= 0 && enemy.current_state == ENEMY_ATTACKING) {
-			changeState(enemy_entity, ENEMY_RECOVERING);
-
-			// remove any attack components with this enemy
-			registry.attacks.remove(enemy_entity);
-			registry.velocities.get(enemy_entity).velocity = vec2(0, 0);
-		}
-		// recover
-		else if (enemy.recovery_timer_ms > 0) {
-			enemy.recovery_timer_ms -= elapsed_ms;
-		}
-		else if (enemy.recovery_timer_ms <= 0 && enemy.current_state == ENEMY_RECOVERING) {
-			changeState(enemy_entity, ENEMY_IDLE);
-			
+	ComponentContainer<Enemy>& enemy_registry = registry.enemies;
+	for (size_t i = 0; i < enemy_registry.components.size(); i++) {
+		Enemy& enemy = enemy_registry.components[i];
+		// states without a timeout stay at infinity
+		enemy.state_timer_ms -= elapsed_ms;
+		if (enemy.state_timer_ms > 0) {
+			continue;
 		}
+		const Enemy_Transition& transition = get_enemy_transition(enemy.type, enemy.current_state);
+		changeState(enemy_registry.entities[i], transition.next);
 	}
 }
 
@@ -303,9 +303,10 @@ void EnemySystem::step(float elapsed_ms) {
 	enemy_cleanup_check();
 	updateTimers(elapsed_ms);
 	updateMovement();
-	for (Entity& enemy_entity : registry.enemies.entities) {
+	// each enemy only updates its own position scale and texture coordinates
+	registry.enemies.parallel_for_each([this](Entity& enemy_entity, Enemy&) {
 		updateTexture(enemy_entity);
-	}
+	});
 }
 
 bool EnemySystem::is_moving(Entity& entity) {
@@ -341,7 +342,7 @@ void EnemySystem::enemy_cleanup_check() {
 
 Entity EnemySystem::create_enemy(RenderSystem& renderer, vec2 position, ENEMY_TYPE type) {
 	const Entity& enemy_entity = Entity();
-	const Enemy_Template& enemyTemplate = enemy_templates.at(type);
+	const Enemy_Template& enemyTemplate = enemy_templates[type];
 
 	auto& pos = registry.positions.emplace(enemy_entity);
 	pos.position = position;
@@ -380,4 +381,22 @@ Entity EnemySystem::create_enemy(RenderSystem& renderer, vec2 position, ENEMY_TY
 	changeState(enemy_entity, ENEMY_IDLE);
 
 	return enemy_entity;
+}
+
+ENEMY_TYPE EnemySystem::random_spawn_type() {
+	float total_weight = 0.f;
+	for (const Enemy_Template& enemyTemplate : enemy_templates) {
+		total_weight += enemyTemplate.spawn_weight;
+	}
+	float roll = rng.uniform() * total_weight;
+	for (int type = 0; type < (int)enemy_templates.size(); type++) {
+		if (enemy_templates[type].spawn_weight <= 0.f) {
+			continue;
+		}
+		roll -= enemy_templates[type].spawn_weight;
+		if (roll <= 0.f) {
+			return (ENEMY_TYPE)type;
+		}
+	}
+	return CHARGER;
 }
\ No newline at end of file
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <unordered_map>
-#include <random>
 #include <cmath>
 #include "../data/states.hpp"
 #include "../data/data_structs.hpp"
@@ -9,10 +8,13 @@
 #include "../common.hpp"
 #include "../tinyECS/registry.hpp"
 #include "../data/enemy_types.hpp"
+#include "../util/spatial_grid.hpp"
 
 class EnemySystem {
 	void changeState(Entity e, ENEMY_STATES);
+	void run_action(Entity e, ENEMY_ACTION action);
 	void updateMovement();
+	vec2 separation(Entity entity, vec2 position);
 	void updateTimers(float elapsed_ms);
 	void updateTexture(Entity player_entity);
 
@@ -26,7 +28,8 @@ class EnemySystem {
 
 	const float CHARGE_SPEED = (BASE_TILE_SIZE_HEIGHT * 6.f);
 
-	//Enemy_Template enemy_templates[enemy_type_count];
+	// spatial grid query scratch
+	std::vector<Entity> nearby_entities;
 
 	// [1] Improved Gameplay: AI
 	void execute_attack(Entity& attacker);
@@ -37,10 +40,6 @@ class EnemySystem {
 
 	void enemy_cleanup_check();
 
-	// C++ random number generator
-	std::default_random_engine rng;
-	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
-
 public:
 	void init(RenderSystem& renderer);
 
@@ -48,6 +47,9 @@ public:
 
 	Entity create_enemy(RenderSystem& renderer, vec2 position, ENEMY_TYPE type);
 
+	// picks a type for a regular spawn using the spawn weights from enemies.json
+	ENEMY_TYPE random_spawn_type();
+
 	bool is_moving(Entity& entity);
 
 	void react_to_damage(Entity& entity);
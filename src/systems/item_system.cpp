@@ -4,6 +4,9 @@
 #include "world_init.hpp"
 #include "../data/items.hpp"
 #include "../tinyECS/registry.hpp"
+#include "../util/spatial_grid.hpp"
+#include "../util/asset_pack.hpp"
+#include "../util/rng.hpp"
 
 Modifier ItemSystem::get_modifier_from_json(nlohmann::json item, std::string bonus_name) {
 	Modifier modifier;
@@ -14,8 +17,7 @@ Modifier ItemSystem::get_modifier_from_json(nlohmann::json item, std::string bon
 }
 
 void ItemSystem::load_items(RenderSystem& renderer) {
-	std::ifstream f(json_path("items.json"));
-	auto data = nlohmann::json::parse(f);
+	auto data = load_json(json_path("items.json"));
 
 	for (int id = 0; id < data.size(); id++) {
 		auto item = data[id];
@@ -40,10 +42,8 @@ void ItemSystem::load_items(RenderSystem& renderer) {
 		current_item.crit_damage_bonus = item["crit_damage_bonus"];
 		current_item.healing_percent = item["healing_percent"];
 
-		GLuint handle;
 		std::string item_texture_path = textures_path(std::string ("items/" + current_item.texture_name));
-        renderer.loadGlTextures(&handle, &item_texture_path, 1);
-		item_handles[current_item.texture_name] = handle;
+		item_handles[current_item.texture_name] = renderer.acquireTexture(item_texture_path);
 
 		items.push_back(current_item);
 
@@ -84,34 +84,44 @@ void ItemSystem::step(float elapsed_ms) {
 		if (i.is_pickup) {
 			i.time_alive += elapsed_ms;
 
-			Entity& player_entity = registry.players.entities[0];
-			Position& player_pos = registry.positions.get(player_entity);
-
-			Position& item_pos = registry.positions.get(e);
-
-			vec2 difference = (player_pos.position - item_pos.position);
-
-			float distance_squared = difference.x * difference.x + difference.y * difference.y;
-
 			if (i.time_alive > ITEM_PICKUP_MIN_DELAY) {
 				i.can_pickup = true;
 			}
 
-			if (i.time_alive > ITEM_PICKUP_SPREAD_TIME * 0.5f && distance_squared < ITEM_PICKUP_RANGE * ITEM_PICKUP_RANGE) {
-				Velocity& item_vel = registry.velocities.get(e);
-				item_vel.velocity += normalize(difference) * ITEM_PICKUP_ACCELERATION;
-			}
-			else if (i.time_alive > ITEM_PICKUP_SPREAD_TIME) {
+			// pickups stop spreading out unless the player was pulling them in
+			if (i.time_alive > ITEM_PICKUP_SPREAD_TIME && !i.pulled) {
 				Velocity& item_vel = registry.velocities.get(e);
 				item_vel.velocity = vec2(0, 0);
 			}
+			i.pulled = false;
+		}
+	}
+
+	if (registry.players.size() == 0) {
+		return;
+	}
+
+	// only the pickups the spatial grid finds near the player get pulled in
+	Entity& player_entity = registry.players.entities[0];
+	Position& player_pos = registry.positions.get(player_entity);
+	nearby_entities.clear();
+	spatial_grid.query_radius(player_pos.position, ITEM_PICKUP_RANGE, nearby_entities);
+	for (Entity& e : nearby_entities) {
+		if (!registry.items.has(e)) continue;
+		Item& i = registry.items.get(e);
+
+		if (i.is_pickup && i.time_alive > ITEM_PICKUP_SPREAD_TIME * 0.5f) {
+			vec2 difference = (player_pos.position - registry.positions.get(e).position);
+			Velocity& item_vel = registry.velocities.get(e);
+			item_vel.velocity += normalize(difference) * ITEM_PICKUP_ACCELERATION;
+			i.pulled = true;
 		}
 	}
 }
 
 ItemInfo ItemSystem::get_random_item() {
 
-	float probability = static_cast<float>(rand()) / RAND_MAX;
+	float probability = rng.uniform();
 	ItemRarity rarity = COMMON;
 
 	for (int i = 0; i < ITEM_RARITY_PROBABILITIES.size(); i++) {
@@ -123,7 +133,7 @@ ItemInfo ItemSystem::get_random_item() {
 		}
 	}
 
-	probability = static_cast<float>(rand()) / RAND_MAX;
+	probability = rng.uniform();
 
 	auto& item_pool = item_rarities[rarity];
 	int index = 0;
@@ -140,28 +150,27 @@ ItemInfo ItemSystem::get_random_item() {
 	return items[0]; // This should never be hit unless there are empty item_pools
 }
 
-Entity ItemSystem::createPickupItem(PICKUP_ITEMS item_type, vec2 start_position, vec2 end_position, float value) {
+// one pickup item per end position, all thrown from start_position
+void ItemSystem::createPickupItems(PICKUP_ITEMS item_type, vec2 start_position, const std::vector<vec2>& end_positions, float value) {
 	std::string item_name = PICKUP_ITEM_STRINGS[item_type];
 
-	ItemInfo i = item_rarities[SPECIAL][item_name];
-
-	Entity item_entity = createItem(i, true);
-
-	Item& item = registry.items.get(item_entity);
-	item.value = value;
-	item.can_pickup = false;
-
-	vec2 vel = end_position - start_position;
+	ItemInfo info = item_rarities[SPECIAL][item_name];
+	GLuint texture_id = item_handles[info.texture_name];
 
-	Velocity& v = registry.velocities.emplace(item_entity);
-	v.velocity = vel / ITEM_PICKUP_SPREAD_TIME * 1000.f;
+	registry.spawn(end_positions.size(), [&](size_t i, Entity e, Item& item, TextureInfo& ti, Velocity& v, Collidable&, Position& pos) {
+		// same components as createItem plus the pickup motion
+		item.info = info;
+		item.is_pickup = true;
+		item.value = value;
+		item.can_pickup = false;
 
-	Collidable& c = registry.collidables.emplace(item_entity);
+		ti.texture_id = texture_id;
 
-	Position& pos = registry.positions.emplace(item_entity);
-	pos.position = start_position;
-	pos.layer = 2;
-	pos.scale = ITEM_SIZE;
+		vec2 vel = end_positions[i] - start_position;
+		v.velocity = vel / ITEM_PICKUP_SPREAD_TIME * 1000.f;
 
-	return item_entity;
+		pos.position = start_position;
+		pos.layer = 2;
+		pos.scale = ITEM_SIZE;
+	}, registry.items, registry.textureinfos, registry.velocities, registry.collidables, registry.positions);
 }
\ No newline at end of file
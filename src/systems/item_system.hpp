@@ -12,6 +12,9 @@ class ItemSystem {
 	std::array<std::unordered_map<std::string, ItemInfo>, ItemRarity::RARITY_COUNT> item_rarities;
 	std::array<float, ItemRarity::RARITY_COUNT> item_rarity_all_spawn_rates;
 
+	// scratch for spatial grid queries
+	std::vector<Entity> nearby_entities;
+
 	void load_items(RenderSystem& renderer);
 	Modifier get_modifier_from_json(nlohmann::json item, std::string bonus_name);
 
@@ -22,7 +25,7 @@ public:
 
 	void step(float elapsed_ms);
 
-	Entity createPickupItem(PICKUP_ITEMS item_type, vec2 start_position, vec2 end_position, float value);
+	void createPickupItems(PICKUP_ITEMS item_type, vec2 start_position, const std::vector<vec2>& end_positions, float value);
 };
 
 
@@ -1,24 +1,26 @@
 #include "particle_system.hpp"
+#include "../util/rng.hpp"
 #include <vector>
 #include <glm/trigonometric.hpp>
 
 void ParticleSystem::step(float elapsed_ms) {
 
-	std::vector<Entity> to_remove;
 	for (Entity e : registry.particles.entities) {
 		Particle &p = registry.particles.get(e);
 		p.life_time -= elapsed_ms;
 		particle_handlers[p.type](e, elapsed_ms);
 		if (p.life_time <= 0) {
-			to_remove.push_back(e);
+			expired.push_back(e);
 		}
 	}
-	while (to_remove.size() > 0) {
-		registry.remove_all_components_of(to_remove.back());
-		to_remove.pop_back();
-	}
 
+}
 
+void ParticleSystem::remove_expired() {
+	while (expired.size() > 0) {
+		registry.remove_all_components_of(expired.back());
+		expired.pop_back();
+	}
 }
 
 void ParticleSystem::linear_partical_handler(Entity& e, float elapsed_ms) {
@@ -72,4 +74,25 @@ Entity ParticleSystem::createParticle(vec2 position, vec2 scale, vec2 velocity,
 	textureInfo.top_left = { 0, 0 };
 
 	return e;
-}
\ No newline at end of file
+}
+
+// count particles thrown outwards from position in random directions, slowing down by drag of their starting velocity per second
+void ParticleSystem::createParticleBurst(vec2 position, vec2 scale, size_t count, float speed, float drag, float life_time, PARTICLE_TEXTURE_ID particle_texture_id, PARTICLE_TYPE particle_type) {
+	GLuint texture_id = particle_texture_handles[(int)particle_texture_id];
+	registry.spawn(count, [&](size_t i, Entity e, Particle& particle, Position& pos, TextureInfo& textureInfo) {
+		float angle = rng.uniform(0.f, 2.f * M_PI);
+		vec2 v = { speed * cos(angle), speed * sin(angle) };
+		particle.type = particle_type;
+		particle.life_time = life_time;
+		particle.acceleration = -v * drag;
+		particle.velocity = v;
+
+		pos.position = position;
+		pos.scale = scale;
+		pos.layer = 0;
+
+		textureInfo.texture_id = texture_id;
+		textureInfo.bottom_right = { 1, 1 };
+		textureInfo.top_left = { 0, 0 };
+	}, registry.particles, registry.positions, registry.textureinfos);
+}
@@ -13,10 +13,15 @@ class ParticleSystem {
 		textures_path("particles/white_bubble.png")
 	};
 	std::array<GLuint, particle_count> particle_texture_handles;
+	// particles whose life ran out in step, removed by remove_expired
+	std::vector<Entity> expired;
 public:
 
 	void getParticleTransforms(std::vector<mat3> &transforms);
+	// only touches particles and positions, so it can run next to other systems
 	void step(float elapsed_ms);
+	// removes the particles step found expired, this touches every container
+	void remove_expired();
 
 	typedef void(*ParticleHandler)(Entity& e, float elapsed_ms);
 
@@ -32,5 +37,6 @@ public:
 	void init(RenderSystem& renderer);
 
 	Entity createParticle(vec2 position, vec2 scale, vec2 velocity, vec2 acceleration, float life_time, PARTICLE_TEXTURE_ID particle_texture_id, PARTICLE_TYPE particle_type);
+	void createParticleBurst(vec2 position, vec2 scale, size_t count, float speed, float drag, float life_time, PARTICLE_TEXTURE_ID particle_texture_id, PARTICLE_TYPE particle_type);
 
 };
\ No newline at end of file
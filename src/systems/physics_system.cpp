@@ -1,6 +1,7 @@
 // internal
 #include "physics_system.hpp"
 #include "world_init.hpp"
+#include "../util/spatial_grid.hpp"
 #include <iostream>
 
 // [7]
@@ -46,16 +47,11 @@ void PhysicsSystem::step(float elapsed_ms)
 	auto& velocity_registry = registry.velocities;
 	float step_seconds = elapsed_ms / 1000.f;
 
-	for(Entity& entity : velocity_registry.entities)
-	{
-		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		// !!! TODO A1: update motion.position based on step_seconds and motion.velocity
-		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		Velocity& velocity = velocity_registry.get(entity);
-
+	// every entity only moves its own position, so hordes are integrated in parallel
+	velocity_registry.parallel_for_each([step_seconds](Entity& entity, Velocity& velocity) {
 		Position& position = registry.positions.get(entity);
 		position.position += velocity.velocity * step_seconds;
-	}
+	});
 
 	auto& movement_function_registry = registry.moveFunctions;
 	for (uint i = 0; i < movement_function_registry.size(); i++)
@@ -104,4 +100,7 @@ void PhysicsSystem::step(float elapsed_ms)
 			}
 		}
 	}
+
+	// everything has moved for this tick, index the new positions for the other systems
+	spatial_grid.rebuild();
 }
\ No newline at end of file
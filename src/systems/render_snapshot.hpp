@@ -0,0 +1,81 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common.hpp"
+#include "../tinyECS/components.hpp"
+#include "../ext/imgui/imgui.h"
+
+// Everything RenderSystem::drawSnapshot needs for one play screen frame, copied out of the
+// registry by RenderSystem::captureSnapshot. Drawing only reads this, never the registry, so
+// a frame can be drawn on the render thread while the main thread simulates the next one.
+
+struct SpriteInstance {
+	mat3 transform;
+	GLuint texture_id;
+	vec4 tiletexcoord;
+	vec3 color;
+	bool damaged;
+	bool dashed;
+	bool is_healthbar;
+	float health;
+};
+
+struct LightInstance {
+	// plain ids here and in ShadowCaster, a default constructed Entity would take a new id
+	unsigned int entity_id;
+	vec2 position;
+	float angle;
+	float radius;
+};
+
+// walls and projectiles, which cast shadows
+struct ShadowCaster {
+	unsigned int entity_id;
+	vec2 position;
+	vec2 scale;
+	// larger side of the sprite, for culling against the light radius
+	float extent;
+	float angle;
+	bool is_map_tile;
+};
+
+// particles sharing a texture, drawn instanced
+struct ParticleBatch {
+	GLuint texture_id;
+	std::vector<mat3> transforms;
+};
+
+struct ImDrawListDeleter {
+	void operator()(ImDrawList* draw_list) const { IM_DELETE(draw_list); }
+};
+
+struct RenderSnapshot {
+	ivec2 framebuffer_size = { 0, 0 };
+	mat3 projection;
+	float darken_factor = 0.f;
+
+	// back to front
+	std::vector<SpriteInstance> sprites;
+	std::vector<LightInstance> lights;
+	std::vector<ShadowCaster> shadow_casters;
+	std::vector<ParticleBatch> particles;
+	std::vector<Font> texts;
+
+	// the ImGui frame, built on the main thread and copied out of the ImGui context
+	ImVec2 ui_display_pos;
+	ImVec2 ui_display_size;
+	ImVec2 ui_framebuffer_scale;
+	std::vector<std::unique_ptr<ImDrawList, ImDrawListDeleter>> ui_draw_lists;
+
+	// empties the snapshot, keeping its allocations for the next capture
+	void clear() {
+		sprites.clear();
+		lights.clear();
+		shadow_casters.clear();
+		particles.clear();
+		texts.clear();
+		ui_draw_lists.clear();
+	}
+};
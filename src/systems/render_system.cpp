@@ -24,9 +24,10 @@
 #include "item_system.hpp"
 #include "../util/util.hpp"
 #include "world_system.hpp"
+#include "../util/render_thread.hpp"
 
 // Creative Component: Particle System
-void RenderSystem::drawParticles(const mat3 &projection, GLuint texture_id, int num_particles) {
+void RenderSystem::drawParticles(const mat3 &projection, const ParticleBatch& batch) {
 	const GLuint program = (GLuint)effects[(int)EFFECT_ASSET_ID::PARTICLE];
 
 	// Setting shaders
@@ -60,9 +61,7 @@ void RenderSystem::drawParticles(const mat3 &projection, GLuint texture_id, int
 			vec3)); // note the stride to skip the preceeding vertex position
 
 	glBindBuffer(GL_ARRAY_BUFFER, particle_transform_VBO);
-	std::vector<mat3> transform;
-	getParticleTransforms(transform, texture_id);
-	glBufferData(GL_ARRAY_BUFFER, transform.size() * sizeof(glm::mat3), transform.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, batch.transforms.size() * sizeof(glm::mat3), batch.transforms.data(), GL_STATIC_DRAW);
 
 	glEnableVertexAttribArray(in_transform_loc);
 	glVertexAttribPointer(in_transform_loc, 3, GL_FLOAT, GL_FALSE, sizeof(glm::mat3), (void*)0);
@@ -83,7 +82,7 @@ void RenderSystem::drawParticles(const mat3 &projection, GLuint texture_id, int
 	glActiveTexture(GL_TEXTURE0);
 	gl_has_errors();
 
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glBindTexture(GL_TEXTURE_2D, batch.texture_id);
 	gl_has_errors();
 
 	GLint currProgram;
@@ -107,41 +106,25 @@ void RenderSystem::drawParticles(const mat3 &projection, GLuint texture_id, int
 
 	GLsizei num_indices = size / sizeof(uint16_t);
 
-	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr, num_particles);
+	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr, (GLsizei)batch.transforms.size());
 
 	gl_has_errors();
 }
 
-void getParticleTransforms(std::vector<mat3>& transforms, GLuint texture_id) {
-	for (Entity e : registry.particles.entities) {
-		TextureInfo texture_info = registry.textureinfos.get(e);
-		if (texture_info.texture_id == texture_id) {
-			Position& position = registry.positions.get(e);
-			Transform transform;
-			transform.translate(position.position);
-			transform.scale(position.scale);
-			transform.rotate(radians(position.angle));
-			transforms.push_back(transform.mat);
-		}
-	}
-}
-
-
-
-void RenderSystem::drawTexturedMesh(Entity entity,
-									const mat3 &projection)
-{
-
-	Position &position = registry.positions.get(entity);
-	TextureInfo& info = registry.textureinfos.get(entity);
+static mat3 entityTransform(vec2 position, vec2 scale, float angle) {
 	// Transformation code, see Rendering and Transformation in the template
 	// specification for more info Incrementally updates transformation matrix,
 	// thus ORDER IS IMPORTANT
 	Transform transform;
-	transform.translate(position.position);
-	transform.scale(position.scale);
-	transform.rotate(radians(position.angle));
+	transform.translate(position);
+	transform.scale(scale);
+	transform.rotate(radians(angle));
+	return transform.mat;
+}
 
+void RenderSystem::drawSprite(const SpriteInstance& sprite,
+									const mat3 &projection)
+{
 	const GLuint program = (GLuint)effects[(int)EFFECT_ASSET_ID::TEXTURED];
 
 	// Setting shaders
@@ -180,51 +163,31 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 			vec3)); // note the stride to skip the preceeding vertex position
 	
 	// [1] Tile coordinates to get area of texture we want to use
-	vec4 tiletexcoord = {info.top_left, info.bottom_right};
+	const vec4& tiletexcoord = sprite.tiletexcoord;
 	glUniform4f(tiletexcoord_loc, tiletexcoord.x, tiletexcoord.y, tiletexcoord.z, tiletexcoord.w);
 	gl_has_errors();
 
 	// M1 Creative Element: Simple rendering effects (flashing effect on attacked)
 	glUniform1f(u_time_loc, glfwGetTime()); // pass a time value
-	bool u_damaged = GL_FALSE;
-	bool u_dashed = GL_FALSE;
-	if (registry.livings.has(entity)) {
-		Living& living = registry.livings.get(entity);
-		u_damaged = living.invincible_time > 0 ? GL_TRUE : GL_FALSE;
-	}
-	if (registry.players.has(entity)){
-		Player& player = registry.players.get(entity);
-		u_dashed = player.current_state == PLAYER_DASHING ? GL_TRUE : GL_FALSE;		
-	}
-	glUniform1f(u_damaged_loc, u_damaged);
+	glUniform1f(u_damaged_loc, sprite.damaged);
 
 	// Healthbar
-	bool u_ishealthbar = false;
-	float u_health = 1;
-
-	if (registry.healthbar.has(entity)) {
-		HealthBar& health = registry.healthbar.get(entity);
-		Player& player = registry.players.components[0];
-		u_health = health.health / player.base_max_health;
-		u_ishealthbar = true;
-	}
-	glUniform1f(u_health_loc, u_health);
-	glUniform1f(u_ishealthbar_loc, u_ishealthbar);
-	glUniform1f(u_dashed_loc, u_dashed);
+	glUniform1f(u_health_loc, sprite.health);
+	glUniform1f(u_ishealthbar_loc, sprite.is_healthbar);
+	glUniform1f(u_dashed_loc, sprite.dashed);
 	
 	// Enabling and binding texture to slot 0
 	glActiveTexture(GL_TEXTURE0);
 	gl_has_errors();
 
 	// [1] Texture ID = Texture Handle in OpenGL
-	glBindTexture(GL_TEXTURE_2D, info.texture_id);
+	glBindTexture(GL_TEXTURE_2D, sprite.texture_id);
 	gl_has_errors();
 
 
 	// Getting uniform locations for glUniform* calls
 	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
+	glUniform3fv(color_uloc, 1, (float *)&sprite.color);
 	gl_has_errors();
 
 	// Get number of indices from index buffer, which has elements uint16_t
@@ -239,7 +202,7 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
 	// Setting uniform values to the currently bound program
 	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
+	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&sprite.transform);
 	gl_has_errors();
 
 	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
@@ -254,7 +217,7 @@ void RenderSystem::drawTexturedMesh(Entity entity,
 // first draw to an intermediate texture,
 // apply the "vignette" texture, when requested
 // then draw the intermediate texture
-void RenderSystem::drawToScreen()
+void RenderSystem::drawToScreen(ivec2 framebuffer_size, float darken_factor, const std::vector<Font>& texts)
 {
 
 	// Setting shaders
@@ -263,10 +226,8 @@ void RenderSystem::drawToScreen()
 	gl_has_errors();
 
 	// Clearing backbuffer
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, w, h);
+	glViewport(0, 0, framebuffer_size.x, framebuffer_size.y);
 	glDepthRange(0, 10);
 	glClearColor(BACKGROUND_COLOUR.r, BACKGROUND_COLOUR.g, BACKGROUND_COLOUR.b, 1.0f);
 	glClearDepth(1.f);
@@ -296,9 +257,6 @@ void RenderSystem::drawToScreen()
 	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
 	glUniform1i(shadow_texture_uloc, 1);
 	
-	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	// std::cout << "screen.darken_screen_factor: " << screen.darken_screen_factor << " entity id: " << screen_state_entity << std::endl;
-	float darken_factor = screen.is_paused || screen.is_death ? 0.1f : screen.darken_screen_factor;
 	glUniform1f(paused_uloc, darken_factor);
 	// if (screen.is_paused) {
 	// 	glUniform1f(paused_uloc, 0.1f);
@@ -334,18 +292,30 @@ void RenderSystem::drawToScreen()
 	gl_has_errors();
 
 	// Render text after drawing sprites
-	for (Entity entity : registry.fonts.entities) {
-		Font& font = registry.fonts.get(entity);
+	for (const Font& font : texts) {
 		renderText(font.text, font.position, font.color, font.scale, font.maxWidth, font.fontName);
 	}
 }
 
-// Render our game world
-// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw()
-{
+float RenderSystem::darkenFactor() {
+	ScreenState &screen = registry.screenStates.get(screen_state_entity);
+	return screen.is_paused || screen.is_death ? 0.1f : screen.darken_screen_factor;
+}
+
+ivec2 RenderSystem::framebufferSize() {
+	int w, h;
+	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	return { w, h };
+}
 
-	mat3 projection_2D = createProjectionMatrix(registry.screenStates.components[0].camera_position);
+// Copies what the play screen draws out of the registry, on the main thread.
+// The ImGui frame is built here too, since it reads the registry and GLFW input.
+void RenderSystem::captureSnapshot(RenderSnapshot& snapshot)
+{
+	snapshot.clear();
+	snapshot.framebuffer_size = framebufferSize();
+	snapshot.projection = createProjectionMatrix(registry.screenStates.components[0].camera_position);
+	snapshot.darken_factor = darkenFactor();
 
 	// draw all entities with a render request to the frame buffer
 	std::vector<Entity> entities = registry.positions.entities;
@@ -354,74 +324,58 @@ void RenderSystem::draw()
 			return registry.positions.get(e).layer < registry.positions.get(other).layer;
 		});
 
-
-	// First get the shadow map/s
-	//getShadowMaps(entities, projection_2D);
-	int count = 0;
-	// Shadows every 3 frames
-	if (count % 3 == 0) {
-		createShadowMap(entities, projection_2D);
-	}
-
-	registry.fonts.clear();
-	// Getting size of window
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-
-	// First render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
-	gl_has_errors();
-
-	// clear backbuffer
-	glViewport(0, 0, w, h);
-	glDepthRange(0.00001, 10);
-
-	// white background
-	glClearColor(BACKGROUND_COLOUR.r, BACKGROUND_COLOUR.g, BACKGROUND_COLOUR.b, 1.0f);
-
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
-	// and alpha blending, one would have to sort
-	// sprites back to front
-	gl_has_errors();
-
+	Player* player = registry.players.size() > 0 ? &registry.players.components[0] : nullptr;
 	for (Entity entity : entities)
 	{
-		// Note, its not very efficient to access elements indirectly via the entity
-		// albeit iterating through all Sprites in sequence. A good point to optimize
-		if (registry.textureinfos.has(entity) && !registry.particles.has(entity)) {
-			drawTexturedMesh(entity, projection_2D);
+		Position& position = registry.positions.get(entity);
+
+		// walls and projectiles cast shadows
+		if ((registry.mapTiles.has(entity) && registry.collidables.has(entity)) || registry.projectiles.has(entity)) {
+			vec2 scale = position.scale;
+			if (registry.collidables.has(entity)) {
+				scale = registry.collidables.get(entity).scale;
+				if (scale == vec2(0, 0)) scale = position.scale;
+			}
+			snapshot.shadow_casters.push_back({ (unsigned int)entity, position.position, scale, max(position.scale.x, position.scale.y), position.angle, registry.mapTiles.has(entity) });
 		}
-		
+
+		if (!registry.textureinfos.has(entity) || registry.particles.has(entity)) {
+			continue;
+		}
+		TextureInfo& info = registry.textureinfos.get(entity);
+		SpriteInstance sprite;
+		sprite.transform = entityTransform(position.position, position.scale, position.angle);
+		sprite.texture_id = info.texture_id;
+		sprite.tiletexcoord = { info.top_left, info.bottom_right };
+		sprite.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+		sprite.damaged = registry.livings.has(entity) && registry.livings.get(entity).invincible_time > 0;
+		sprite.dashed = registry.players.has(entity) && registry.players.get(entity).current_state == PLAYER_DASHING;
+		sprite.is_healthbar = registry.healthbar.has(entity) && player != nullptr;
+		sprite.health = sprite.is_healthbar ? registry.healthbar.get(entity).health / player->base_max_health : 1.f;
+		snapshot.sprites.push_back(sprite);
+	}
+
+	for (Entity light_entity : registry.lightSources.entities) {
+		Position& position = registry.positions.get(light_entity);
+		snapshot.lights.push_back({ (unsigned int)light_entity, position.position, position.angle, registry.lightSources.get(light_entity).radius });
 	}
 
 	// Creative Component: Particle System
+	// one instanced draw per texture
 	std::vector<Entity> particle_entities = registry.particles.entities;
 	std::sort(particle_entities.begin(), particle_entities.end(),
 		[](Entity e, Entity other) {
 			return registry.textureinfos.get(e).texture_id < registry.textureinfos.get(other).texture_id;
 		});
-
-	if (registry.particles.size() > 0) {
-		int num_particles = 0;
-		GLuint id_to_compare = registry.textureinfos.get(particle_entities[0]).texture_id;
-		for (Entity e : particle_entities) {
-			if (registry.textureinfos.get(e).texture_id == id_to_compare) {
-				num_particles += 1;
-			}
-			else {
-				drawParticles(projection_2D, id_to_compare, num_particles);
-				id_to_compare = registry.textureinfos.get(e).texture_id;
-				num_particles = 1;
-			}
+	for (Entity e : particle_entities) {
+		GLuint texture_id = registry.textureinfos.get(e).texture_id;
+		if (snapshot.particles.size() == 0 || snapshot.particles.back().texture_id != texture_id) {
+			snapshot.particles.push_back({ texture_id });
 		}
-		drawParticles(projection_2D, id_to_compare, num_particles);
+		Position& position = registry.positions.get(e);
+		snapshot.particles.back().transforms.push_back(entityTransform(position.position, position.scale, position.angle));
 	}
 
-
 	// [5] Improved Gameplay: Gameplay Tutorial
 	// Only in Tutorial
 	ScreenState& screen_state = registry.screenStates.get(screen_state_entity);
@@ -479,28 +433,24 @@ void RenderSystem::draw()
 			break;
 		}
 
-		Entity font_title = Entity();
-		Font& tutorialTitle = registry.fonts.emplace(font_title);
+		Font tutorialTitle;
 		tutorialTitle.text = "Tutorial";
 		tutorialTitle.position = vec2(getCenteredX(tutorialTitle.text, 1.5f, "KnightWarrior"), 600);
 		tutorialTitle.color = vec3(1.f);
 		tutorialTitle.scale = 1.5f;
 		tutorialTitle.maxWidth = 600.f;
 		tutorialTitle.fontName = "KnightWarrior";
+		snapshot.texts.push_back(tutorialTitle);
 
-		Entity tutorialText = Entity();
-		Font& tutorialInstructions = registry.fonts.emplace(tutorialText);
+		Font tutorialInstructions;
 		tutorialInstructions.text = instruction;
 		tutorialInstructions.position = vec2(40, 500);
 		tutorialInstructions.color = vec3(1.f);
 		tutorialInstructions.scale = 0.5f;
 		tutorialInstructions.maxWidth = 800.f;
+		snapshot.texts.push_back(tutorialInstructions);
 	}
 
-	// draw framebuffer to screen
-	// adding "vignette" effect when applied
-	drawToScreen();
-
 	// M4 Creative Component: External Integration
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -544,13 +494,85 @@ void RenderSystem::draw()
 	}
 
 	ImGui::Render();
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	// the draw lists belong to the ImGui context and are rebuilt next frame, so keep copies
+	ImDrawData* draw_data = ImGui::GetDrawData();
+	snapshot.ui_display_pos = draw_data->DisplayPos;
+	snapshot.ui_display_size = draw_data->DisplaySize;
+	snapshot.ui_framebuffer_scale = draw_data->FramebufferScale;
+	for (ImDrawList* draw_list : draw_data->CmdLists) {
+		snapshot.ui_draw_lists.emplace_back(draw_list->CloneOutput());
+	}
+}
+
+// Render our game world from a snapshot, touching only GL state
+// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
+void RenderSystem::drawSnapshot(const RenderSnapshot& snapshot)
+{
+	// First get the shadow map/s
+	createShadowMap(snapshot);
+
+	// First render to the custom framebuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	gl_has_errors();
+
+	// clear backbuffer
+	glViewport(0, 0, snapshot.framebuffer_size.x, snapshot.framebuffer_size.y);
+	glDepthRange(0.00001, 10);
+
+	// white background
+	glClearColor(BACKGROUND_COLOUR.r, BACKGROUND_COLOUR.g, BACKGROUND_COLOUR.b, 1.0f);
+
+	glClearDepth(10.f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
+	// and alpha blending, one would have to sort
+	// sprites back to front
+	gl_has_errors();
+
+	for (const SpriteInstance& sprite : snapshot.sprites)
+	{
+		drawSprite(sprite, snapshot.projection);
+	}
+
+	// Creative Component: Particle System
+	for (const ParticleBatch& batch : snapshot.particles) {
+		drawParticles(snapshot.projection, batch);
+	}
+
+	// draw framebuffer to screen
+	// adding "vignette" effect when applied
+	drawToScreen(snapshot.framebuffer_size, snapshot.darken_factor, snapshot.texts);
+
+	ImDrawData draw_data;
+	draw_data.Valid = true;
+	draw_data.DisplayPos = snapshot.ui_display_pos;
+	draw_data.DisplaySize = snapshot.ui_display_size;
+	draw_data.FramebufferScale = snapshot.ui_framebuffer_scale;
+	for (const auto& draw_list : snapshot.ui_draw_lists) {
+		draw_data.AddDrawList(draw_list.get());
+	}
+	ImGui_ImplOpenGL3_RenderDrawData(&draw_data);
 
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
 	gl_has_errors();
 }
 
+// Draw the play screen, on the render thread when one is running
+void RenderSystem::draw()
+{
+	captureSnapshot(frame_snapshot);
+	if (render_thread.is_running()) {
+		render_thread.submit(frame_snapshot);
+	}
+	else {
+		drawSnapshot(frame_snapshot);
+	}
+}
+
+
 // For New Feature: Item Stat Block
 void RenderSystem::drawItemStat(Entity& item_entity) {
 	Item& items = registry.items.get(item_entity);
@@ -649,7 +671,7 @@ void RenderSystem::drawPausedScreen(ScreenManager& screenManager) {
 	pausedScreenTitle.fontName = "KnightWarrior";
 
 	drawMenu(screenManager);
-	drawToScreen();
+	drawToScreen(framebufferSize(), darkenFactor(), registry.fonts.components);
 
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
@@ -733,12 +755,9 @@ void RenderSystem::drawInventoryScreen() {
 }
 
 void RenderSystem::drawUpgradeScreen(ScreenManager& screenManager, UpgradeSystem& upgrade_system) {
-	GLuint handle;
-	std::vector<GLuint> iconTextures(iconFiles.size());
-
-	for (int i = 0; i < iconFiles.size(); ++i) {
-		loadGlTextures(&handle, &iconFiles[i], 1);
-		iconTextures[i] = handle;
+	if (iconTextures.size() == 0) {
+		iconTextures = std::vector<GLuint>(iconFiles.size(), 0);
+		loadGlTextures(iconTextures.data(), iconFiles.data(), iconFiles.size());
 	}
 
 	// Start ImGui frame
@@ -981,7 +1000,7 @@ void RenderSystem::drawDeathScreen(ScreenManager& screenManager) {
 	deathScreenTitle.fontName = "KnightWarrior";
 
 	drawMenu(screenManager);
-	drawToScreen();
+	drawToScreen(framebufferSize(), darkenFactor(), registry.fonts.components);
 
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
@@ -1101,6 +1120,7 @@ float RenderSystem::getCenteredX(const std::string& text, float scale, std::stri
 }
 
 void RenderSystem::shutdown(GLFWwindow* window) {
+	render_thread.stop();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -1108,24 +1128,24 @@ void RenderSystem::shutdown(GLFWwindow* window) {
 
 
 // M4 Creative Component: Dynamic shadows
-void RenderSystem::createShadowMap(std::vector<Entity> entities, const mat3& projection) {
+void RenderSystem::createShadowMap(const RenderSnapshot& snapshot) {
+	const mat3& projection = snapshot.projection;
 	
 	glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
 	glClearColor(0.f, 0.f, 0.f, 0.0f);
 	glClearDepth(1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	for (Entity lightSource : registry.lightSources.entities) {
+	for (const LightInstance& light : snapshot.lights) {
 
 		glBindFramebuffer(GL_FRAMEBUFFER, lightShadowFBO);
 		glClearColor(0.f, 0.f, 0.f, 0.0f);
 		glClearDepth(1.f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		drawLight(lightSource, projection);
+		drawLight(light, projection);
 
-		LightSource& ls = registry.lightSources.get(lightSource);
-		vec2 lightPosition = vec2(registry.positions.get(lightSource).position);
+		vec2 lightPosition = light.position;
 
 		const GLuint program = (GLuint)effects[(int)EFFECT_ASSET_ID::SHADOW];
 
@@ -1170,35 +1190,21 @@ void RenderSystem::createShadowMap(std::vector<Entity> entities, const mat3& pro
 
 
 		// Reuse program for all entities
-		for (Entity entity : entities) {
-			if (!((registry.mapTiles.has(entity) && registry.collidables.has(entity)) 
-				|| registry.projectiles.has(entity)) 
-				|| entity == lightSource) {
+		for (const ShadowCaster& caster : snapshot.shadow_casters) {
+			if (caster.entity_id == light.entity_id) {
 				continue;
 			}
 
+			const ShadowCaster& p = caster;
 
-			Position p = registry.positions.get(entity);
-
-			if (glm::distance(p.position, lightPosition) > ls.radius + max(p.scale.x, p.scale.y)) {
+			if (glm::distance(p.position, lightPosition) > light.radius + p.extent) {
 				continue;
 			}
 
 			vec2 scale = p.scale;
-			if (registry.collidables.has(entity)) {
-				scale = registry.collidables.get(entity).scale;
-				if (scale == vec2(0, 0)) scale = p.scale;
-			}
+			mat3 transform = entityTransform(p.position, scale, p.angle);
 
-			// Transformation code, see Rendering and Transformation in the template
-			// specification for more info Incrementally updates transformation matrix,
-			// thus ORDER IS IMPORTANT
-			Transform transform;
-			transform.translate(p.position);
-			transform.scale(scale);
-			transform.rotate(radians(p.angle));
-
-			glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
+			glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform);
 			gl_has_errors();
 
 			// Do 4 different draws:
@@ -1208,7 +1214,7 @@ void RenderSystem::createShadowMap(std::vector<Entity> entities, const mat3& pro
 
 
 			// If the light is on the right side...
-			if (lightPosition.x > (p.position.x - scale.x/2.f) || registry.mapTiles.has(entity)) {
+			if (lightPosition.x > (p.position.x - scale.x/2.f) || p.is_map_tile) {
 				// LEFT
 				vertices = {
 					{-0.5, -0.5, 1.0},
@@ -1237,7 +1243,7 @@ void RenderSystem::createShadowMap(std::vector<Entity> entities, const mat3& pro
 
 
 			// If the light is on the top side...
-			if (lightPosition.y < (p.position.y + scale.y / 2.f) || registry.mapTiles.has(entity)) {
+			if (lightPosition.y < (p.position.y + scale.y / 2.f) || p.is_map_tile) {
 				// BOTTOM
 				vertices = {
 					{-0.5, 0.5, 1.0},
@@ -1265,7 +1271,7 @@ void RenderSystem::createShadowMap(std::vector<Entity> entities, const mat3& pro
 
 
 			// If the light is on the left side...
-			if (lightPosition.x < (p.position.x + scale.x / 2.f) || registry.mapTiles.has(entity)) {
+			if (lightPosition.x < (p.position.x + scale.x / 2.f) || p.is_map_tile) {
 				// RIGHT
 				vertices = {
 					{0.5, -0.5, 1.0},
@@ -1293,7 +1299,7 @@ void RenderSystem::createShadowMap(std::vector<Entity> entities, const mat3& pro
 
 
 			// If the light is on the bottom side...
-			if (lightPosition.y > (p.position.y - scale.y / 2.f) || registry.mapTiles.has(entity)) {
+			if (lightPosition.y > (p.position.y - scale.y / 2.f) || p.is_map_tile) {
 				// TOP
 				vertices = {
 					{-0.5, -0.5, 1.0},
@@ -1379,17 +1385,9 @@ void RenderSystem::updateShadowMap() {
 	gl_has_errors();
 }
 
-void RenderSystem::drawLight(Entity light_entity, const mat3& projection) {
+void RenderSystem::drawLight(const LightInstance& light, const mat3& projection) {
 	// just draw a projectile based on the light parameters
-	Position& position = registry.positions.get(light_entity);
-	LightSource& ls = registry.lightSources.get(light_entity);
-	// Transformation code, see Rendering and Transformation in the template
-	// specification for more info Incrementally updates transformation matrix,
-	// thus ORDER IS IMPORTANT
-	Transform transform;
-	transform.translate(position.position);
-	transform.scale(vec2(ls.radius));
-	transform.rotate(radians(position.angle));
+	mat3 transform = entityTransform(light.position, vec2(light.radius), light.angle);
 
 	const GLuint program = (GLuint)effects[(int)EFFECT_ASSET_ID::TEXTURED];
 
@@ -1449,7 +1447,7 @@ void RenderSystem::drawLight(Entity light_entity, const mat3& projection) {
 	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
 	// Setting uniform values to the currently bound program
 	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
+	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform);
 	gl_has_errors();
 
 	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
@@ -2,13 +2,18 @@
 
 #include <array>
 #include <utility>
+#include <memory>
+#include <future>
 
 #include "common.hpp"
 #include "../tinyECS/components.hpp"
 #include "../tinyECS/tiny_ecs.hpp"
 
 #include <map>
+#include <unordered_map>
 #include "util/screen_manager.hpp"
+#include "util/shader_watcher.hpp"
+#include "render_snapshot.hpp"
 #include "upgrade_system.hpp"
 
 // imgui
@@ -22,6 +27,13 @@
 class ScreenManager;
 class UpgradeSystem;
 
+// pixels decoded from an image file, produced off the main thread and uploaded on it
+struct DecodedTexture {
+	std::string path;
+	ivec2 size = { 0, 0 };
+	std::unique_ptr<stbi_uc, void(*)(void*)> pixels = { nullptr, stbi_image_free };
+};
+
 class RenderSystem {
 	/**
 	 * The following arrays store the assets the game will use. They are loaded
@@ -95,13 +107,35 @@ public:
 
 	void initializeGlEffects();
 
+	// recompiles the effects whose shader files changed on disk, called between frames.
+	// An effect that fails to compile keeps its previous program.
+	void reloadChangedShaders();
+
 	void initializeGlMeshes();
 
 	void initializeShadows();
 
+	// acquires each path from the texture cache, release them with releaseTexture
 	void loadGlTextures(GLuint* handles, const std::string* texture_paths, size_t num_textures);
-	
-	void unloadMapTilesets(GLuint* handles, int num_handles);
+
+	// Textures are shared by path: the first acquire decodes and uploads the image, later ones
+	// reuse its handle, and the last release deletes it.
+	GLuint acquireTexture(const std::string& path);
+	// same, but uploads pixels decoded ahead of time (by a worker) when the path is not resident yet
+	GLuint acquireTexture(DecodedTexture& texture);
+	void releaseTexture(const std::string& path);
+
+	// decoding touches no GL state, so it is safe to call from a worker thread
+	static bool decodeTexture(const std::string& path, DecodedTexture& texture);
+
+	// uploads already decoded textures into the handles, releasing their pixels
+	void uploadGlTextures(GLuint* handles, DecodedTexture* textures, size_t num_textures);
+
+	// Startup batch: between begin and end, acquiring a new path returns its handle right away
+	// and decodes the image on the thread pool. endTextureBatch waits for the decodes and uploads
+	// them, so nothing may draw with those handles before it. init() opens the batch.
+	void beginTextureBatch();
+	void endTextureBatch();
 
 	Mesh& getMesh(GEOMETRY_BUFFER_ID id) { return meshes[(int)id]; };
 
@@ -109,6 +143,9 @@ public:
 
 	void initializeGlGeometryBuffers();
 
+	// renders the glyphs of every font into CPU bitmaps, no GL calls so it can run on a worker
+	bool rasterizeFonts();
+	// uploads the rasterized glyphs (rasterizing first if that has not happened) and sets up the text buffers
 	bool fontInit(GLFWwindow* window);
 	bool initImGui(GLFWwindow* window);
 	void shutdown(GLFWwindow* window);
@@ -132,9 +169,14 @@ public:
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
 
-	// Draw all entities
+	// Draw all entities: captures a snapshot and draws it, or hands it to the render thread when one runs
 	void draw();
 
+	// copies what the play screen shows out of the registry and builds the ImGui frame, main thread only
+	void captureSnapshot(RenderSnapshot& snapshot);
+	// draws a captured frame and swaps buffers, reads nothing but the snapshot and the loaded GL resources
+	void drawSnapshot(const RenderSnapshot& snapshot);
+
 	mat3 createProjectionMatrix(vec2 position);
 
 	Entity get_screen_state_entity() { return screen_state_entity; }
@@ -146,13 +188,15 @@ public:
 
 private:
 	// Internal drawing functions for each entity type
-	void drawParticles(const mat3& projection, GLuint texture_id, int num_particles);
-	void drawTexturedMesh(Entity entity, const mat3& projection);
-	void drawToScreen();
+	void drawParticles(const mat3& projection, const ParticleBatch& batch);
+	void drawSprite(const SpriteInstance& sprite, const mat3& projection);
+	void drawToScreen(ivec2 framebuffer_size, float darken_factor, const std::vector<Font>& texts);
 	void drawInventoryScreen();
-	void createShadowMap(std::vector<Entity> entities, const mat3& projection);
+	void createShadowMap(const RenderSnapshot& snapshot);
 	void updateShadowMap();
-	void drawLight(Entity light_entity, const mat3& projection);
+	void drawLight(const LightInstance& light, const mat3& projection);
+	float darkenFactor();
+	ivec2 framebufferSize();
 
 	// Window handle
 	GLFWwindow* window;
@@ -168,6 +212,9 @@ private:
 
 	Entity screen_state_entity;
 
+	// reused by draw() every frame
+	RenderSnapshot frame_snapshot;
+
 	// font elements
 	std::map<std::string, std::map<char, Character>> m_fonts;
 	GLuint m_font_shaderProgram;
@@ -193,6 +240,33 @@ private:
 		"Player",
 		"Parry"
 	};
+	std::vector<GLuint> iconTextures;
+
+	struct CachedTexture {
+		GLuint handle = 0;
+		int references = 0;
+	};
+	std::unordered_map<std::string, CachedTexture> texture_cache;
+
+	struct PendingTexture {
+		GLuint handle;
+		std::future<DecodedTexture> decoded;
+	};
+	ShaderWatcher shader_watcher;
+	std::vector<std::string> changed_shader_files;
+
+	bool texture_batch_open = false;
+	std::vector<PendingTexture> pending_textures;
+
+	struct RasterizedGlyph {
+		char character;
+		glm::ivec2 size;
+		glm::ivec2 bearing;
+		unsigned int advance;
+		std::vector<unsigned char> bitmap;
+	};
+	// filled by rasterizeFonts, emptied by fontInit
+	std::map<std::string, std::vector<RasterizedGlyph>> rasterized_fonts;
 	GLuint particle_VAO;
 	GLuint particle_transform_VBO;
 
@@ -202,7 +276,7 @@ private:
 
 };
 
+// compiles and links the two shaders into out_program, asserting on errors unless required is false
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program, bool required = true);
 
-void getParticleTransforms(std::vector<mat3>& transforms, GLuint texture_id);
@@ -3,11 +3,16 @@
 #include <sstream>
 #include <array>
 #include <fstream>
+#include <filesystem>
+#include <cstring>
 
 // internal
 #include "../ext/stb_image/stb_image.h"
 #include "render_system.hpp"
 #include "tinyECS/registry.hpp"
+#include "util/thread_pool.hpp"
+#include "util/asset_pack.hpp"
+#include "util/render_thread.hpp"
 
 // fonts
 #include <ft2build.h>
@@ -21,37 +26,130 @@
 
 	for a vector this is achieved by initializing it with a number of default values.
 	i.e. vector<GLuint> handles = vector<GLuint>(num_textures, 0)  
+
+	Each texture comes from the texture cache, so an image already loaded by another system is not decoded again.
 */
 void RenderSystem::loadGlTextures(GLuint* handles, const std::string* texture_paths, size_t num_textures) {
+	for (uint i = 0; i < num_textures; i++)
+	{
+		handles[i] = acquireTexture(texture_paths[i]);
+	}
+}
+
+GLuint RenderSystem::acquireTexture(const std::string& path) {
+	auto it = texture_cache.find(path);
+	if (it != texture_cache.end()) {
+		it->second.references++;
+		return it->second.handle;
+	}
+	if (texture_batch_open) {
+		CachedTexture& cached = texture_cache[path];
+		glGenTextures(1, &cached.handle);
+		cached.references = 1;
+		std::shared_ptr<std::promise<DecodedTexture>> promise = std::make_shared<std::promise<DecodedTexture>>();
+		pending_textures.push_back({ cached.handle, promise->get_future() });
+		thread_pool.submit([promise, path]() {
+			DecodedTexture texture;
+			decodeTexture(path, texture);
+			promise->set_value(std::move(texture));
+		});
+		return cached.handle;
+	}
+	DecodedTexture texture;
+	decodeTexture(path, texture);
+	return acquireTexture(texture);
+}
+
+GLuint RenderSystem::acquireTexture(DecodedTexture& texture) {
+	auto it = texture_cache.find(texture.path);
+	if (it != texture_cache.end()) {
+		texture.pixels.reset();
+		it->second.references++;
+		return it->second.handle;
+	}
+	// the worker skips images that were resident when it started
+	if (texture.pixels == nullptr) {
+		decodeTexture(texture.path, texture);
+	}
+	CachedTexture& cached = texture_cache[texture.path];
+	uploadGlTextures(&cached.handle, &texture, 1);
+	cached.references = 1;
+	return cached.handle;
+}
+
+void RenderSystem::releaseTexture(const std::string& path) {
+	auto it = texture_cache.find(path);
+	assert(it != texture_cache.end() && "Releasing a texture that was never acquired");
+	if (it == texture_cache.end()) {
+		return;
+	}
+	it->second.references--;
+	if (it->second.references == 0) {
+		render_thread.claim_context();
+		glDeleteTextures(1, &it->second.handle);
+		texture_cache.erase(it);
+	}
+}
+
+static void keepPackedPixels(void*) {
+}
+
+bool RenderSystem::decodeTexture(const std::string& path, DecodedTexture& texture) {
+	texture.path = path;
+	// packed textures are already RGBA, they upload straight from the mapped pack
+	AssetView packed;
+	if (asset_pack.find(path, ASSET_TEXTURE, packed)) {
+		texture.size = { packed.width, packed.height };
+		texture.pixels = std::unique_ptr<stbi_uc, void(*)(void*)>((stbi_uc*)packed.data, keepPackedPixels);
+		return true;
+	}
+	texture.pixels.reset(stbi_load(path.c_str(), &texture.size.x, &texture.size.y, NULL, 4));
+	return texture.pixels != nullptr;
+}
+
+static void uploadTexturePixels(GLuint handle, DecodedTexture& texture) {
+	if (texture.pixels == nullptr)
+	{
+		const std::string message = "Could not load the file " + texture.path + ".";
+		fprintf(stderr, "%s", message.c_str());
+		assert(false);
+	}
+	glBindTexture(GL_TEXTURE_2D, handle);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.size.x, texture.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.pixels.get());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	gl_has_errors();
+	texture.pixels.reset();
+}
+
+void RenderSystem::uploadGlTextures(GLuint* handles, DecodedTexture* textures, size_t num_textures) {
+	render_thread.claim_context();
 	glGenTextures((GLsizei) num_textures, handles);
 
 	for (uint i = 0; i < num_textures; i++)
 	{
-		const std::string& path = texture_paths[i];
-		ivec2 dimensions; // We can add this if we need dimensions. For now ignored...
+		uploadTexturePixels(handles[i], textures[i]);
+	}
+}
 
-		stbi_uc* data;
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+void RenderSystem::beginTextureBatch() {
+	texture_batch_open = true;
+}
 
-		if (data == NULL)
-		{
-			const std::string message = "Could not load the file " + path + ".";
-			fprintf(stderr, "%s", message.c_str());
-			assert(false);
+void RenderSystem::endTextureBatch() {
+	texture_batch_open = false;
+	for (PendingTexture& pending : pending_textures) {
+		DecodedTexture texture = pending.decoded.get();
+		// skip textures released again before the batch ended, their handle is gone
+		auto it = texture_cache.find(texture.path);
+		if (it == texture_cache.end() || it->second.handle != pending.handle) {
+			continue;
 		}
-		glBindTexture(GL_TEXTURE_2D, handles[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		gl_has_errors();
-		stbi_image_free(data);
+		uploadTexturePixels(pending.handle, texture);
 	}
-}
-
-void RenderSystem::unloadMapTilesets(GLuint* handles, int num_handles) {
-	glDeleteTextures((GLsizei)num_handles, handles);
+	pending_textures.clear();
 }
 
 // Render initialization
@@ -96,9 +194,14 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 	glBindVertexArray(vao);
 	gl_has_errors();
 
+	// startup textures, including every system's acquired after this, decode on the thread pool
+	beginTextureBatch();
+
 	initScreenTexture();
     initializeGlTextures();
 	initializeGlEffects();
+	// edits to shaders/ are picked up by reloadChangedShaders, where inotify is available
+	shader_watcher.start(shader_path(""));
 	initializeGlGeometryBuffers();
 	particleInit();
 	initializeShadows();
@@ -128,8 +231,7 @@ bool RenderSystem::initTexturedQuad() {
 	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*) (2*sizeof(GLfloat)));
 	glBindVertexArray(0);
 
-	std::string path = textures_path("startscreen/startscreen.png");
-	loadGlTextures(&quad_texture, &path, 1);
+	quad_texture = acquireTexture(textures_path("startscreen/startscreen.png"));
 
 	return true;
 }
@@ -146,15 +248,7 @@ bool RenderSystem::particleInit() {
 	return true;
 }
 
-bool RenderSystem::fontInit(GLFWwindow* window) {
-	// enable blending or you will just get solid boxes instead of text
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	// font buffer setup
-	glGenVertexArrays(1, &m_font_VAO);
-	glGenBuffers(1, &m_font_VBO);
-
+bool RenderSystem::rasterizeFonts() {
 	// init FreeType fonts
 	FT_Library ft;
 	if (FT_Init_FreeType(&ft))
@@ -169,12 +263,13 @@ bool RenderSystem::fontInit(GLFWwindow* window) {
 		{"KenneyPixel", font_path("Kenney_Pixel_Square.ttf")}
 	};
 
-	// disable byte-alignment restriction in OpenGL
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
 	for (const auto& [fontName, fontPath] : fonts) {
 		FT_Face face;
-		if (FT_New_Face(ft, fontPath.c_str(), 0, &face)) {
+		AssetView packed;
+		FT_Error error = asset_pack.find(fontPath, ASSET_RAW, packed)
+			? FT_New_Memory_Face(ft, packed.data, (FT_Long)packed.size, 0, &face)
+			: FT_New_Face(ft, fontPath.c_str(), 0, &face);
+		if (error) {
 			std::cerr << "ERROR::FREETYPE: Failed to load font" << std::endl;
 			continue;
 		}
@@ -182,7 +277,7 @@ bool RenderSystem::fontInit(GLFWwindow* window) {
 		// Set font size
 		FT_Set_Pixel_Sizes(face, 0, fontName == "KnightWarrior" ? 50 : 40);
 
-		std::map<char, Character> characterMap;
+		std::vector<RasterizedGlyph>& glyphs = rasterized_fonts[fontName];
 
 		// load each of the chars - note only first 128 ASCII chars
 		for (unsigned char c = (unsigned char)0; c < (unsigned char)128; c++)
@@ -194,6 +289,52 @@ bool RenderSystem::fontInit(GLFWwindow* window) {
 				continue;
 			}
 
+			// copied tightly packed, the upload assumes an unpack alignment of 1
+			const FT_Bitmap& bitmap = face->glyph->bitmap;
+			RasterizedGlyph glyph = {
+				(char)c,
+				glm::ivec2(bitmap.width, bitmap.rows),
+				glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+				static_cast<unsigned int>(face->glyph->advance.x),
+				std::vector<unsigned char>(bitmap.width * bitmap.rows)
+			};
+			for (unsigned int row = 0; row < bitmap.rows; row++) {
+				std::copy(bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + bitmap.width, glyph.bitmap.begin() + row * bitmap.width);
+			}
+			glyphs.push_back(std::move(glyph));
+		}
+
+		//clean up
+		FT_Done_Face(face);
+	}
+
+	// clean up
+	FT_Done_FreeType(ft);
+
+	return true;
+}
+
+bool RenderSystem::fontInit(GLFWwindow* window) {
+	if (rasterized_fonts.size() == 0 && !rasterizeFonts()) {
+		return false;
+	}
+
+	// enable blending or you will just get solid boxes instead of text
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// font buffer setup
+	glGenVertexArrays(1, &m_font_VAO);
+	glGenBuffers(1, &m_font_VBO);
+
+	// disable byte-alignment restriction in OpenGL
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (const auto& [fontName, glyphs] : rasterized_fonts) {
+		std::map<char, Character> characterMap;
+
+		for (const RasterizedGlyph& glyph : glyphs)
+		{
 			// generate texture
 			unsigned int texture;
 			glGenTextures(1, &texture);
@@ -203,12 +344,12 @@ bool RenderSystem::fontInit(GLFWwindow* window) {
 				GL_TEXTURE_2D,
 				0,
 				GL_RED,
-				face->glyph->bitmap.width,
-				face->glyph->bitmap.rows,
+				glyph.size.x,
+				glyph.size.y,
 				0,
 				GL_RED,
 				GL_UNSIGNED_BYTE,
-				face->glyph->bitmap.buffer
+				glyph.bitmap.size() > 0 ? glyph.bitmap.data() : nullptr
 			);
 
 			// set texture options
@@ -220,26 +361,21 @@ bool RenderSystem::fontInit(GLFWwindow* window) {
 			// now store character for later use
 			Character character = {
 				texture,
-				glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-				glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-				static_cast<unsigned int>(face->glyph->advance.x),
-				(char)c
+				glyph.size,
+				glyph.bearing,
+				glyph.advance,
+				glyph.character
 			};
-			characterMap.insert({c, character});
+			characterMap.insert({glyph.character, character});
 		}
 		
 		m_fonts.insert({fontName, characterMap});
-		
-		//clean up
-		FT_Done_Face(face);
 	}
+	rasterized_fonts.clear();
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-	// clean up
-	FT_Done_FreeType(ft);
-
 	// bind buffers
 	glGenVertexArrays(1, &m_font_VAO);
 	glGenBuffers(1, &m_font_VBO);
@@ -300,6 +436,33 @@ void RenderSystem::initializeGlEffects()
 	}
 }
 
+void RenderSystem::reloadChangedShaders() {
+	changed_shader_files.clear();
+	shader_watcher.poll(changed_shader_files);
+	if (changed_shader_files.size() == 0) {
+		return;
+	}
+	render_thread.claim_context();
+	for (uint i = 0; i < effect_paths.size(); i++) {
+		std::string effect_name = std::filesystem::path(effect_paths[i]).filename().string();
+		bool changed = false;
+		for (const std::string& file : changed_shader_files) {
+			changed = changed || file == effect_name + ".vs.glsl" || file == effect_name + ".fs.glsl";
+		}
+		if (!changed) {
+			continue;
+		}
+		GLuint program = 0;
+		if (!loadEffectFromFile(effect_paths[i] + ".vs.glsl", effect_paths[i] + ".fs.glsl", program, false)) {
+			std::cerr << "Shader " << effect_name << " failed to compile, keeping the previous version" << std::endl;
+			continue;
+		}
+		glDeleteProgram(effects[i]);
+		effects[i] = program;
+		std::cout << "Reloaded shader " << effect_name << std::endl;
+	}
+}
+
 // One could merge the following two functions as a template function...
 template <class T>
 void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices)
@@ -430,8 +593,11 @@ RenderSystem::~RenderSystem()
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
-	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
 	glDeleteTextures(1, &off_screen_render_buffer_color);
+	// texture_gl_handles and the map tilesets all come from the cache, so it owns every texture
+	for (auto& cached : texture_cache) {
+		glDeleteTextures(1, &cached.second.handle);
+	}
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
 	gl_has_errors();
 
@@ -501,8 +667,106 @@ bool gl_compile_shader(GLuint shader)
 	return true;
 }
 
+// Linked programs are cached next to the save file, one binary per effect, keyed by a hash of
+// the shader sources and the driver strings. The driver may still reject a binary (after an
+// update for instance), then the effect is compiled as usual and the cache rewritten.
+const uint32_t SHADER_CACHE_VERSION = 1;
+
+struct ShaderCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+};
+
+static bool programBinarySupported() {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0 && glGetProgramBinary != nullptr && glProgramBinary != nullptr;
+}
+
+static std::string shaderCachePath(const std::string& vs_path) {
+	// coloured.vs.glsl -> coloured
+	std::string effect_name = std::filesystem::path(vs_path).stem().stem().string();
+	return json_path("shader_cache/" + effect_name + ".bin");
+}
+
+// FNV-1a over the sources and the strings identifying the driver
+static uint64_t shaderCacheKey(const std::string& vs_str, const std::string& fs_str) {
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const char* text, size_t length) {
+		for (size_t i = 0; i < length; i++) {
+			hash = (hash ^ (uint8_t)text[i]) * 1099511628211ull;
+		}
+		hash = (hash ^ 0xff) * 1099511628211ull;
+	};
+	add(vs_str.data(), vs_str.size());
+	add(fs_str.data(), fs_str.size());
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const char* value = (const char*)glGetString(name);
+		if (value != nullptr) {
+			add(value, strlen(value));
+		}
+	}
+	return hash;
+}
+
+static bool loadProgramBinary(const std::string& cache_path, uint64_t key, GLuint& out_program) {
+	std::ifstream in(cache_path, std::ios::binary);
+	ShaderCacheHeader header;
+	if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, "SKYS", 4) != 0 ||
+		header.version != SHADER_CACHE_VERSION || header.key != key) {
+		return false;
+	}
+	std::vector<char> binary(header.length);
+	if (!in.read(binary.data(), binary.size())) {
+		return false;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), (GLsizei)header.length);
+	GLint is_linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+	// a format the driver dropped raises GL_INVALID_ENUM, that is a cache miss and not an error
+	while (glGetError() != GL_NO_ERROR);
+	if (is_linked == GL_FALSE) {
+		glDeleteProgram(program);
+		return false;
+	}
+	out_program = program;
+	return true;
+}
+
+static void saveProgramBinary(const std::string& cache_path, uint64_t key, GLuint program) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	if (gl_has_errors()) {
+		return;
+	}
+
+	ShaderCacheHeader header = {};
+	memcpy(header.magic, "SKYS", 4);
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.format = format;
+	header.length = (uint32_t)length;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(cache_path).parent_path(), error);
+	std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+	out.write((const char*)&header, sizeof(header));
+	out.write(binary.data(), length);
+}
+
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program)
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program, bool required)
 {
 	// Opening files
 	std::ifstream vs_is(vs_path);
@@ -510,7 +774,7 @@ bool loadEffectFromFile(
 	if (!vs_is.good() || !fs_is.good())
 	{
 		fprintf(stderr, "Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
-		assert(false);
+		assert(!required);
 		return false;
 	}
 
@@ -525,6 +789,14 @@ bool loadEffectFromFile(
 	GLsizei vs_len = (GLsizei)vs_str.size();
 	GLsizei fs_len = (GLsizei)fs_str.size();
 
+	// a cached binary skips compiling and linking altogether
+	bool use_binary_cache = programBinarySupported();
+	std::string cache_path = shaderCachePath(vs_path);
+	uint64_t cache_key = shaderCacheKey(vs_str, fs_str);
+	if (use_binary_cache && loadProgramBinary(cache_path, cache_key, out_program)) {
+		return true;
+	}
+
 	GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vs_src, &vs_len);
 	GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
@@ -535,18 +807,24 @@ bool loadEffectFromFile(
 	if (!gl_compile_shader(vertex))
 	{
 		fprintf(stderr, "Vertex compilation failed");
-		assert(false);
+		assert(!required);
+		// gl_compile_shader already deleted the failed shader
+		glDeleteShader(fragment);
 		return false;
 	}
 	if (!gl_compile_shader(fragment))
 	{
 		fprintf(stderr, "Fragment compilation failed");
-		assert(false);
+		assert(!required);
+		glDeleteShader(vertex);
 		return false;
 	}
 
 	// Linking
 	out_program = glCreateProgram();
+	if (use_binary_cache) {
+		glProgramParameteri(out_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glAttachShader(out_program, vertex);
 	glAttachShader(out_program, fragment);
 	glLinkProgram(out_program);
@@ -564,7 +842,11 @@ bool loadEffectFromFile(
 			gl_has_errors();
 
 			fprintf(stderr, "Link error: %s", log.data());
-			assert(false);
+			assert(!required);
+			glDeleteProgram(out_program);
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			out_program = 0;
 			return false;
 		}
 	}
@@ -577,6 +859,10 @@ bool loadEffectFromFile(
 	glDeleteShader(fragment);
 	gl_has_errors();
 
+	if (use_binary_cache) {
+		saveProgramBinary(cache_path, cache_key, out_program);
+	}
+
 	return true;
 }
 
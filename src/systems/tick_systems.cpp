@@ -0,0 +1,37 @@
+#include "tick_systems.hpp"
+#include "ai_system.hpp"
+#include "animation_system.hpp"
+#include "physics_system.hpp"
+#include "world_system.hpp"
+#include "../tinyECS/registry.hpp"
+#include "../util/spatial_grid.hpp"
+
+void add_tick_systems(SystemScheduler& scheduler, WorldSystem& world_system, PlayerSystem& player_system,
+	AISystem& ai_system, EnemySystem& enemy_system, ItemSystem& item_system, AnimationSystem& animation_system,
+	PhysicsSystem& physics_system, ParticleSystem& particle_system) {
+	// CK: be mindful of the order of your systems and rearrange this list only if necessary
+	// these create or remove entities, or play sounds
+	scheduler.add_exclusive("world", [&](float ms) { world_system.step(ms); });
+	scheduler.add_exclusive("player", [&](float ms) { player_system.step(ms); });
+	scheduler.add_exclusive("ai", [&](float ms) { ai_system.step(ms); });
+	scheduler.add_exclusive("enemy", [&](float ms) { enemy_system.step(ms); });
+	scheduler.add("item",
+		{ &registry.players, &registry.positions, &spatial_grid },
+		{ &registry.items, &registry.velocities },
+		[&](float ms) { item_system.step(ms); });
+	// the end of a player attack animation resets the player state
+	scheduler.add("animation",
+		{},
+		{ &registry.animations, &registry.players },
+		[&](float ms) { animation_system.step(ms); });
+	scheduler.add("physics",
+		{ &registry.collidables },
+		{ &registry.positions, &registry.velocities, &registry.moveFunctions, &registry.collisions, &spatial_grid },
+		[&](float ms) { physics_system.step(ms); });
+	scheduler.add("particle",
+		{},
+		{ &registry.particles, &registry.positions },
+		[&](float ms) { particle_system.step(ms); });
+	scheduler.add_exclusive("particle cleanup", [&](float) { particle_system.remove_expired(); });
+	scheduler.add_exclusive("collisions", [&](float) { world_system.handle_collisions(); });
+}
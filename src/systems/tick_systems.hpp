@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../util/system_scheduler.hpp"
+
+class WorldSystem;
+class PlayerSystem;
+class AISystem;
+class EnemySystem;
+class ItemSystem;
+class AnimationSystem;
+class PhysicsSystem;
+class ParticleSystem;
+
+// Adds the systems of one simulation tick to scheduler, in the order they ran before; each waits
+// only for the earlier systems it shares data with (see system_scheduler.hpp).
+// The game and the headless runner both build their tick here, so they simulate the same thing.
+void add_tick_systems(SystemScheduler& scheduler, WorldSystem& world_system, PlayerSystem& player_system,
+	AISystem& ai_system, EnemySystem& enemy_system, ItemSystem& item_system, AnimationSystem& animation_system,
+	PhysicsSystem& physics_system, ParticleSystem& particle_system);
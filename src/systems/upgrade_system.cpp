@@ -1,6 +1,7 @@
 #include "upgrade_system.hpp"
 #include <iostream>
 #include "../tinyECS/registry.hpp"
+#include "../util/asset_pack.hpp"
 
 void UpgradeSystem::get_current_upgrades(std::vector<UpgradeInfo>& out) {
 	assert(registry.gameStates.size() > 0);
@@ -39,8 +40,7 @@ Modifier UpgradeSystem::get_modifier_from_json(nlohmann::json item, std::string
 }
 
 void UpgradeSystem::load_upgrade_tree(RenderSystem& renderer, std::string name, UpgradeTree& tree) {
-	std::ifstream f(json_path(name + ".json"));
-	auto data = nlohmann::json::parse(f);
+	auto data = load_json(json_path(name + ".json"));
 
 	for (int id = 0; id < data.size(); id++) {
 
@@ -80,10 +80,8 @@ void UpgradeSystem::load_upgrade_tree(RenderSystem& renderer, std::string name,
 			current_upgrade.special_cooldown_reduction = get_modifier_from_json(upgrade, "special_cooldown_reduction");
 			current_upgrade.special_duration = get_modifier_from_json(upgrade, "special_duration");
 			
-			GLuint handle;
 			std::string upgrade_texture_path = textures_path(std::string("upgrades/" + current_upgrade.texture_name));
-			renderer.loadGlTextures(&handle, &upgrade_texture_path, 1);
-			upgrade_handles[current_upgrade.texture_name] = handle;
+			upgrade_handles[current_upgrade.texture_name] = renderer.acquireTexture(upgrade_texture_path);
 
 			tree.add_upgrade(current_upgrade.upgrade_name, current_upgrade);
 
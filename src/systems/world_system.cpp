@@ -14,6 +14,8 @@
 
 #include "physics_system.hpp"
 #include "../util/map_parser.hpp"
+#include "../util/asset_pack.hpp"
+#include "../util/rng.hpp"
 #include "../../ext/nlohmann/json.hpp"
 
 bool WorldSystem::is_itempopup_visible = false;
@@ -23,11 +25,12 @@ WorldSystem::WorldSystem() :
 	points(0),
 	max_towers(MAX_TOWERS_START)
 {
-	// seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
 }
 
 WorldSystem::~WorldSystem() {
+	// the room prefetch reads the asset pack, finish it before static destruction can tear that down
+	map_loader.waitForPrefetch();
+
 	// Destroy music components
 	if (background_start_music != nullptr)
 		Mix_FreeMusic(background_start_music);
@@ -122,7 +125,28 @@ GLFWwindow* WorldSystem::create_window() {
 	return window;
 }
 
+// sounds come from the asset pack when it has them, SDL reads them from the mapped memory
+static Mix_Music* load_music(const std::string& path) {
+	AssetView packed;
+	if (asset_pack.find(path, ASSET_RAW, packed)) {
+		return Mix_LoadMUS_RW(SDL_RWFromConstMem(packed.data, (int)packed.size), 1);
+	}
+	return Mix_LoadMUS(path.c_str());
+}
+
+static Mix_Chunk* load_sound(const std::string& path) {
+	AssetView packed;
+	if (asset_pack.find(path, ASSET_RAW, packed)) {
+		return Mix_LoadWAV_RW(SDL_RWFromConstMem(packed.data, (int)packed.size), 1);
+	}
+	return Mix_LoadWAV(path.c_str());
+}
+
 bool WorldSystem::start_and_load_sounds() {
+	return start_audio() && load_sounds();
+}
+
+bool WorldSystem::start_audio() {
 	
 	//////////////////////////////////////
 	// Loading music and sounds with SDL
@@ -135,19 +159,22 @@ bool WorldSystem::start_and_load_sounds() {
 		fprintf(stderr, "Failed to open audio device");
 		return false;
 	}
+	return true;
+}
 
+bool WorldSystem::load_sounds() {
 	// M3 Creative Component: Audio Integration
-	background_start_music = Mix_LoadMUS(audio_path("start_music.wav").c_str());
-	background_game_music = Mix_LoadMUS(audio_path("game_music.wav").c_str());
-	background_paused_music = Mix_LoadMUS(audio_path("paused_music.wav").c_str());
-	sword_swing_sound = Mix_LoadWAV(audio_path("sword_swing.wav").c_str());
-	laser_sound = Mix_LoadWAV(audio_path("laser.wav").c_str());
-	souls_pickup = Mix_LoadWAV(audio_path("souls-pickup.wav").c_str());
-	item_equip = Mix_LoadWAV(audio_path("item-equip.wav").c_str());
-	menu_change = Mix_LoadWAV(audio_path("menu_change.wav").c_str());
-	enter = Mix_LoadWAV(audio_path("enter.wav").c_str());
-	parry = Mix_LoadWAV(audio_path("parry.wav").c_str());
-	dash = Mix_LoadWAV(audio_path("dash.wav").c_str());
+	background_start_music = load_music(audio_path("start_music.wav"));
+	background_game_music = load_music(audio_path("game_music.wav"));
+	background_paused_music = load_music(audio_path("paused_music.wav"));
+	sword_swing_sound = load_sound(audio_path("sword_swing.wav"));
+	laser_sound = load_sound(audio_path("laser.wav"));
+	souls_pickup = load_sound(audio_path("souls-pickup.wav"));
+	item_equip = load_sound(audio_path("item-equip.wav"));
+	menu_change = load_sound(audio_path("menu_change.wav"));
+	enter = load_sound(audio_path("enter.wav"));
+	parry = load_sound(audio_path("parry.wav"));
+	dash = load_sound(audio_path("dash.wav"));
 
 	Mix_VolumeChunk(sword_swing_sound, 32);
 	Mix_VolumeChunk(laser_sound, 64);
@@ -188,8 +215,6 @@ void WorldSystem::init(RenderSystem* renderer_arg, PlayerSystem* player_system,
 
 	registry.gameStates.emplace(game_state_entity);
 
-	srand((int) std::chrono::system_clock::now().time_since_epoch().count());
-
 	// start playing background music indefinitely
 	std::cout << "Starting music..." << std::endl;
 	Mix_PlayMusic(background_start_music, -1);
@@ -201,11 +226,7 @@ void WorldSystem::init(RenderSystem* renderer_arg, PlayerSystem* player_system,
     restart_game();
 }
 
-// Update our game world
-bool WorldSystem::step(float elapsed_ms_since_last_update, float actual_elapsed_ms) {
-
-	GameState& game_state = registry.gameStates.components[0];
-
+void WorldSystem::update_fps(float actual_elapsed_ms) {
 	// Updating window title with points
 	std::stringstream title_ss;
 	
@@ -227,7 +248,12 @@ bool WorldSystem::step(float elapsed_ms_since_last_update, float actual_elapsed_
 	} else {
 		glfwSetWindowTitle(window, "SKYSEEKER");
 	}
-	
+}
+
+// Update our game world
+bool WorldSystem::step(float elapsed_ms_since_last_update) {
+
+	GameState& game_state = registry.gameStates.components[0];
 
 	// Remove debug info from the last step
 	while (registry.debugComponents.entities.size() > 0)
@@ -258,15 +284,18 @@ bool WorldSystem::step(float elapsed_ms_since_last_update, float actual_elapsed_
 	auto& healthbar_entity = registry.healthbar.entities[0];
 	updateHealthbarPosition(healthbar_entity, screen.camera_position);
 
-	for (Living& living : registry.livings.components) {
+	registry.livings.parallel_for_each([elapsed_ms_since_last_update](Entity&, Living& living) {
 		living.invincible_time -= elapsed_ms_since_last_update;
-	}
+	});
 
 	// spawn more enemies if 1 or fewer enemies on map
 	Entity screen_state_entity = renderer->get_screen_state_entity();
 	ScreenState& screen_state = registry.screenStates.get(screen_state_entity);
 
-	if (registry.enemies.size() <=1 && num_waves > 0 && !screen_state.tutorialActive) {
+	if (horde_size > 0 && !screen_state.tutorialActive) {
+		spawn_horde();
+	}
+	else if (registry.enemies.size() <=1 && num_waves > 0 && !screen_state.tutorialActive) {
 		spawn_enemy_pack();
 		num_waves--;
 	}
@@ -504,7 +533,7 @@ void WorldSystem::deal_damage(Entity& attacker, Entity& attacked, bool is_specia
 	damage *= damage_multiplier;
 
 	// if random number generated is at or below crit rate * 100, apply crit dmg
-	int random_number = rand() % 100 + 1;
+	int random_number = rng.below(100) + 1;
 	if (attacked_living.crit_rate * 100 >= random_number) {
 		float crit_dmg_bonus =  attacked_living.crit_damage;
 
@@ -603,7 +632,8 @@ bool WorldSystem::collide_triangle(Entity& entity, Entity& other) {
 }
 
 void WorldSystem::handle_enemy_killed(Entity enemy_entity) {
-	Position& pos = registry.positions.get(enemy_entity);
+	// copied, the particles and drops below grow the position container
+	Position pos = registry.positions.get(enemy_entity);
 	Enemy& e = registry.enemies.get(enemy_entity);
 
 	Entity screen_state_entity = renderer->get_screen_state_entity();
@@ -616,39 +646,36 @@ void WorldSystem::handle_enemy_killed(Entity enemy_entity) {
 		num_drops = 0;
 	}
 
-	for (int i = 0; i < 100; i++) {
-		float angle = 2 * M_PI * rand() / RAND_MAX;
-		float speed = BASE_TILE_SIZE_WIDTH;
-		vec2 v = { speed * cos(angle), speed * sin(angle) };
-		particle_system->createParticle(pos.position, { 10, 10 }, v * 2.0f, -v * 1.5f, 1000.0, PARTICLE_TEXTURE_ID::TEST_PARTICLE, ACCELERATED);
-	}
-	
-	for (int i = 0; i < num_drops; i++) {
-		float angle = rand() * M_PI * 2.f / 180.f;
-		float spread = rand() * ITEM_PICKUP_MAX_SPREAD_DISTANCE / RAND_MAX;
+	// particles and drops are each created in one bulk spawn
+	particle_system->createParticleBurst(pos.position, { 10, 10 }, 100, BASE_TILE_SIZE_WIDTH * 2.0f, 0.75f, 1000.0, PARTICLE_TEXTURE_ID::TEST_PARTICLE, ACCELERATED);
+
+	vec2 start_position = pos.position;
+	std::vector<vec2> end_positions;
+	end_positions.reserve(std::max(num_drops, num_health_drops));
 
-		vec2 start_position = pos.position;
-		vec2 end_position = start_position + vec2(cos(angle), sin(angle)) * ITEM_PICKUP_MAX_SPREAD_DISTANCE;
+	for (int i = 0; i < num_drops; i++) {
+		float angle = rng.uniform(0.f, 2.f * M_PI);
+		float spread = rng.uniform(0.f, ITEM_PICKUP_MAX_SPREAD_DISTANCE);
 
-		item_system->createPickupItem(SOULS, start_position, end_position, 1.0f); // TODO: get soul count from enemy
+		end_positions.push_back(start_position + vec2(cos(angle), sin(angle)) * ITEM_PICKUP_MAX_SPREAD_DISTANCE);
 	}
+	item_system->createPickupItems(SOULS, start_position, end_positions, 1.0f); // TODO: get soul count from enemy
 
 	// M4 New Items (health drop)
+	end_positions.clear();
 	for (int i = 0; i < num_health_drops; i++) {
 
-		float random_percent = rand() % 101;
+		float random_percent = rng.below(101);
 
 		if (random_percent <= HEALTH_DROP_SPAWN_PERCENT) {
 
-			float angle = rand() * M_PI * 2.f / 180.f;
-			float spread = rand() * ITEM_PICKUP_MAX_SPREAD_DISTANCE / RAND_MAX;
+			float angle = rng.uniform(0.f, 2.f * M_PI);
+			float spread = rng.uniform(0.f, ITEM_PICKUP_MAX_SPREAD_DISTANCE);
 
-			vec2 start_position = pos.position;
-			vec2 end_position = start_position + vec2(cos(angle), sin(angle)) * ITEM_PICKUP_MAX_SPREAD_DISTANCE;
-
-			item_system->createPickupItem(HEALTH, start_position, end_position, HEALTH_DROP_HEAL_PERCENT);
+			end_positions.push_back(start_position + vec2(cos(angle), sin(angle)) * ITEM_PICKUP_MAX_SPREAD_DISTANCE);
 		}
 	}
+	item_system->createPickupItems(HEALTH, start_position, end_positions, HEALTH_DROP_HEAL_PERCENT);
 
 	enemy_system->handle_enemy_death(enemy_entity);
 }
@@ -736,8 +763,6 @@ void WorldSystem::handle_exit_collision() {
 	player_pos.position.x = entrance_pos.x + BASE_TILE_SIZE_WIDTH;
 	player_pos.position.y = entrance_pos.y;
 
-	int enemy_spawn_type;
-
 	//if (registry.enemySpawns.size() > 0) {
 	//	rewards_spawned = false;
 	//}
@@ -750,13 +775,7 @@ void WorldSystem::handle_exit_collision() {
 			type = BOSS;
 		}
 		else {
-			enemy_spawn_type = rand() % 2;
-			if (enemy_spawn_type > 0) {
-				type = RANGED;
-			}
-			else {
-				type = CHARGER;
-			}
+			type = enemy_system->random_spawn_type();
 		}
 		Position& spawnPos = registry.positions.get(spawn);
 		this->enemy_system->create_enemy(*renderer, spawnPos.position, type);
@@ -899,6 +918,35 @@ void WorldSystem::spawn_enemy_pack() {
 	
 }
 
+void WorldSystem::set_horde_size(unsigned int size) {
+	horde_size = size;
+}
+
+// tops the room back up to horde_size enemies, a batch per step so a big horde ramps up instead of hitching
+void WorldSystem::spawn_horde() {
+	const NavGrid& grid = map_loader.getNavGrid();
+	if (grid.empty()) {
+		return;
+	}
+	vec2 player_position = registry.positions.get(registry.players.entities[0]).position;
+	float min_distance = AI_PRIORITY_RANGE_TILES * BASE_TILE_SIZE_WIDTH;
+	int cell_count = grid.width * grid.height;
+
+	int spawns = 0;
+	int attempts = 0;
+	while (registry.enemies.size() < horde_size && spawns < HORDE_SPAWNS_PER_STEP && attempts < HORDE_SPAWNS_PER_STEP * 4) {
+		attempts++;
+		int cell = rng.below(cell_count);
+		vec2 position = grid.cell_center(cell);
+		// don't drop enemies on top of the player
+		if (grid.blocked[cell] || distance(position, player_position) < min_distance) {
+			continue;
+		}
+		enemy_system->create_enemy(*renderer, position, enemy_system->random_spawn_type());
+		spawns++;
+	}
+}
+
 // Handle healthbar position
 void WorldSystem::updateHealthbarPosition(Entity e, vec2 camera_position) {
 	HealthBar& health_bar = registry.healthbar.get(e);
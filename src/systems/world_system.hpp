@@ -5,7 +5,6 @@
 
 // stlib
 #include <vector>
-#include <random>
 
 #define SDL_MAIN_HANDLED
 #include <SDL.h>
@@ -33,6 +32,12 @@ public:
 	// starts and loads music and sound effects
 	bool start_and_load_sounds();
 
+	// opens the audio device, SDL wants this on the main thread
+	bool start_audio();
+
+	// loads music and sound effects once start_audio succeeded, safe to run on a worker
+	bool load_sounds();
+
 	// call to close the window
 	void close_window();
 
@@ -43,7 +48,10 @@ public:
 	~WorldSystem();
 
 	// steps the game ahead by ms milliseconds
-	bool step(float elapsed_ms, float actual_elapsed_ms);
+	bool step(float elapsed_ms);
+
+	// counts a rendered frame for the fps shown in the window title
+	void update_fps(float actual_elapsed_ms);
 
 	// check for collisions generated by the physics system
 	void handle_collisions();
@@ -52,6 +60,9 @@ public:
 	bool is_over() const;
 
 	void spawn_enemy_pack();
+
+	// load testing: keeps size enemies in the room instead of spawning waves, 0 turns it off
+	void set_horde_size(unsigned int size);
 	void handle_enemy_killed(Entity enemy_entity);
 
 	// restart level
@@ -68,6 +79,9 @@ public:
 private:
 
 	unsigned int num_waves = 2;
+	unsigned int horde_size = 0;
+
+	void spawn_horde();
 
 	Entity* selected_item_entity = NULL;
 
@@ -144,8 +158,4 @@ private:
 	Mix_Chunk* parry;
 	Mix_Chunk* dash;
 	Mix_Music* current_music = background_start_music;
-
-	// C++ random number generator
-	std::default_random_engine rng;
-	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 };
@@ -66,14 +66,14 @@ struct Enemy {
 	ENEMY_TYPE type = CHARGER;
 	bool sees_player = false;
 	float speed = 0.0f;
-	float flinch_timer_ms = 0.0f;
 	ENEMY_STATES current_state = ENEMY_IDLE;
-	float windup_timer_ms = 0.f;
-	float attack_timer_ms = 0.f;
-	float recovery_timer_ms = 0.f;
+	// time left in current_state before its transition fires, set from the type's state table
+	float state_timer_ms = INFINITY;
 	int souls_value = 0;
 	int health_value = 0;
 	float attack_range = 0.0f;
+	// time since the AI scheduler last updated this enemy, starts due so new enemies react right away
+	float ms_since_ai_update = AI_PATHFINDING_INTERVAL_MS;
 };
 
 struct Item {
@@ -84,6 +84,7 @@ struct Item {
 	bool can_pickup = true;; // Can item currently be picked up
 
 	float time_alive = 0.f;
+	bool pulled = false; // was pulled toward the player last step
 };
 
 struct Sword {
@@ -147,6 +148,14 @@ struct PathNode {
 	std::vector<PathNode*> edges;
 	int id;
 	int node_to_connect;
+
+	// A* bookkeeping, only valid while search_id matches the AISystem's current search
+	unsigned int search_id = 0;
+	float cost_so_far = 0.f;
+	PathNode* came_from = nullptr;
+	bool closed = false;
+	// belongs to a moving entity (enemy or player), skipped when walking obstacle graphs
+	bool ignored = false;
 };
 
 struct MapTile {
@@ -1,10 +1,11 @@
 #pragma once
+#include <atomic>
 
 // Unique identifier for all entities
 class Entity
 {
     unsigned int m_id;
-    static unsigned int id_count;   // defaults to 0 (invalid), need to init 1
+    static std::atomic<unsigned int> id_count;   // defaults to 0 (invalid), need to init 1. atomic so systems on worker threads can create entities
 
 public:
 
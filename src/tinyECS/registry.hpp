@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <tuple>
 
 #include "tiny_ecs.hpp"
 #include "components.hpp"
@@ -111,6 +112,32 @@ public:
 		for (ContainerInterface* reg : registry_list)
 			reg->remove(e);
 	}
+
+	// Reserve room for count more entities in each of the given containers
+	template <typename... Containers>
+	void reserve(size_t count, Containers&... containers) {
+		(containers.reserve(count), ...);
+	}
+
+	// Bulk spawn: creates count entities of one archetype, each with a default component in every given container.
+	// Space is reserved up front, then init(i, entity, components...) is called with references to the new
+	// components in container order. Components outside the archetype can be emplaced from init as usual.
+	template <typename Init, typename... Containers>
+	void spawn(size_t count, Init init, Containers&... containers) {
+		reserve(count, containers...);
+		for (size_t i = 0; i < count; i++) {
+			Entity e;
+			spawn_one(i, e, init, containers...);
+		}
+	}
+
+private:
+	template <typename Init, typename... Containers>
+	void spawn_one(size_t i, Entity e, Init& init, Containers&... containers) {
+		// braced initialization keeps the emplaces in container order
+		std::tuple<decltype(containers.components.back())...> components{ containers.emplace(e)... };
+		std::apply([&](auto&... component) { init(i, e, component...); }, components);
+	}
 };
 
 extern ECSRegistry registry;
\ No newline at end of file
@@ -2,6 +2,6 @@
 #include "tiny_ecs.hpp"
 
 // All we need to store besides the containers is the id of every entity and callbacks to be able to remove entities across containers
-unsigned int Entity::id_count = 0;
+std::atomic<unsigned int> Entity::id_count{ 0 };
 
 Entity Entity::null_entity = Entity();
\ No newline at end of file
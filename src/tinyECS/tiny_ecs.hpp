@@ -9,6 +9,10 @@
 #include <assert.h>
 
 #include "entity.hpp"
+#include "../util/thread_pool.hpp"
+
+// below this many components per chunk, parallel_for_each runs on the calling thread
+const size_t PARALLEL_FOR_EACH_MIN_CHUNK = 256;
 
 
 // Common interface to refer to all containers in the ECS registry
@@ -63,9 +67,10 @@ public:
 	};
 
 	// A wrapper to return the component of an entity
+	// Looks the entity up without inserting, so systems reading the same container can run concurrently
 	Component& get(Entity e) {
 		assert(has(e) && "Entity not contained in ECS registry");
-		return components[map_entity_componentID[e]];
+		return components[map_entity_componentID.find(e)->second];
 	}
 
 	// Check if entity has a component of type 'Component'
@@ -95,6 +100,32 @@ public:
 		}
 	};
 
+	// Make room for count more components, so a batch of inserts doesn't reallocate or rehash part way through.
+	// Grows at least geometrically, so reserving repeatedly for small batches stays amortized.
+	void reserve(size_t count)
+	{
+		size_t needed = components.size() + count;
+		if (needed > components.capacity())
+		{
+			size_t capacity = std::max(needed, components.capacity() * 2);
+			components.reserve(capacity);
+			entities.reserve(capacity);
+			map_entity_componentID.reserve(capacity);
+		}
+	}
+
+	// Calls fn(entity, component) for every component, in chunks spread over the thread pool when the
+	// container is large enough. fn may run concurrently for different components, so it must only
+	// write data of the entity it is given, and must not add or remove components.
+	template <typename Fn>
+	void parallel_for_each(Fn fn, size_t min_chunk = PARALLEL_FOR_EACH_MIN_CHUNK)
+	{
+		thread_pool.parallel_for(components.size(), min_chunk, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				fn(entities[i], components[i]);
+		});
+	}
+
 	// Remove all components of type 'Component'
 	void clear()
 	{
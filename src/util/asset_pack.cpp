@@ -0,0 +1,217 @@
+#include "asset_pack.hpp"
+#include "../common.hpp"
+#include "../../ext/stb_image/stb_image.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+AssetPack asset_pack;
+
+const size_t SKYPACK_ALIGNMENT = 16;
+
+// key of a data file inside the pack, empty if path is outside data/
+static std::string pack_key(const std::string& path) {
+	fs::path relative = fs::path(path).lexically_normal().lexically_relative(fs::path(data_path()).lexically_normal());
+	std::string key = relative.generic_string();
+	if (key.empty() || key.rfind("..", 0) == 0) {
+		return "";
+	}
+	return key;
+}
+
+bool AssetPack::open(const std::string& path) {
+	close();
+	if (!file.open(path) || file.size() < sizeof(SkypackHeader)) {
+		return false;
+	}
+	header = (const SkypackHeader*)file.data();
+	entries = (const SkypackEntry*)(file.data() + sizeof(SkypackHeader));
+	if (memcmp(header->magic, "SKYP", 4) != 0 || header->version != SKYPACK_VERSION ||
+		sizeof(SkypackHeader) + sizeof(SkypackEntry) * header->entry_count > file.size()) {
+		close();
+		return false;
+	}
+	for (uint32_t i = 0; i < header->entry_count; i++) {
+		if (entries[i].offset + entries[i].size > file.size()) {
+			close();
+			return false;
+		}
+	}
+	std::error_code error;
+	pack_time = fs::last_write_time(path, error);
+	return true;
+}
+
+void AssetPack::close() {
+	file.close();
+	header = nullptr;
+	entries = nullptr;
+}
+
+bool AssetPack::find(const std::string& path, ASSET_KIND kind, AssetView& view) const {
+	if (!is_open()) {
+		return false;
+	}
+	std::string key = pack_key(path);
+	const SkypackEntry* end = entries + header->entry_count;
+	const SkypackEntry* entry = std::lower_bound(entries, end, key, [](const SkypackEntry& e, const std::string& k) {
+		return strncmp(e.path, k.c_str(), sizeof(e.path)) < 0;
+	});
+	if (entry == end || key != entry->path || entry->kind != kind) {
+		return false;
+	}
+	// an asset edited since packing is read from disk until the pack is rebuilt
+	std::error_code error;
+	fs::file_time_type source_time = fs::last_write_time(path, error);
+	if (!error && source_time > pack_time) {
+		return false;
+	}
+	view.data = file.data() + entry->offset;
+	view.size = (size_t)entry->size;
+	view.width = (int)entry->width;
+	view.height = (int)entry->height;
+	return true;
+}
+
+std::string AssetPack::pack_path() {
+	return data_path() + "/cache/assets.skypack";
+}
+
+json load_json(const std::string& path) {
+	AssetView view;
+	if (asset_pack.find(path, ASSET_JSON, view)) {
+		return json::from_msgpack(view.data, view.data + view.size);
+	}
+	std::ifstream f(path);
+	return json::parse(f);
+}
+
+bool AssetPacker::run_from_args(int argc, char* argv[], int& exit_code) {
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--pack-assets") {
+			exit_code = pack(AssetPack::pack_path()) ? EXIT_SUCCESS : EXIT_FAILURE;
+			return true;
+		}
+	}
+	return false;
+}
+
+// what the pack stores for a data file, false if it is not packed
+static bool asset_kind(const std::string& key, ASSET_KIND& kind) {
+	std::string extension = fs::path(key).extension().string();
+	if (extension == ".png") {
+		kind = ASSET_TEXTURE;
+		return true;
+	}
+	// saves are written at runtime, maps are compiled separately
+	if (extension == ".json" && key.rfind("json/", 0) == 0 && key != "json/save_game.json") {
+		kind = ASSET_JSON;
+		return true;
+	}
+	if (extension == ".wav" || extension == ".ttf" || extension == ".otf") {
+		kind = ASSET_RAW;
+		return true;
+	}
+	return false;
+}
+
+bool AssetPacker::pack(const std::string& pack_path) {
+	struct Source {
+		std::string key;
+		std::string path;
+		ASSET_KIND kind;
+	};
+	std::vector<Source> sources;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(data_path())) {
+		if (!entry.is_regular_file()) {
+			continue;
+		}
+		std::string path = entry.path().string();
+		std::string key = pack_key(path);
+		ASSET_KIND kind;
+		if (key.rfind("cache/", 0) == 0 || !asset_kind(key, kind)) {
+			continue;
+		}
+		if (key.size() >= sizeof(SkypackEntry::path)) {
+			std::cerr << "Skipping " << key << ", path too long for the asset pack" << std::endl;
+			continue;
+		}
+		sources.push_back({ key, path, kind });
+	}
+	std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.key < b.key; });
+
+	std::error_code error;
+	fs::create_directories(fs::path(pack_path).parent_path(), error);
+	std::string temp_path = pack_path + ".tmp";
+	std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "ERROR: could not write " << temp_path << std::endl;
+		return false;
+	}
+
+	SkypackHeader header = {};
+	memcpy(header.magic, "SKYP", 4);
+	header.version = SKYPACK_VERSION;
+	header.entry_count = (uint32_t)sources.size();
+	std::vector<SkypackEntry> entries(sources.size(), SkypackEntry{});
+	// the index is rewritten once the blob offsets are known
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)entries.data(), sizeof(SkypackEntry) * entries.size());
+	uint64_t offset = sizeof(header) + sizeof(SkypackEntry) * entries.size();
+
+	for (size_t i = 0; i < sources.size(); i++) {
+		const Source& source = sources[i];
+		SkypackEntry& entry = entries[i];
+		strncpy(entry.path, source.key.c_str(), sizeof(entry.path) - 1);
+		entry.kind = source.kind;
+
+		std::vector<uint8_t> blob;
+		if (source.kind == ASSET_TEXTURE) {
+			int width, height;
+			stbi_uc* pixels = stbi_load(source.path.c_str(), &width, &height, NULL, 4);
+			if (pixels == nullptr) {
+				std::cerr << "ERROR: could not decode " << source.path << std::endl;
+				return false;
+			}
+			blob.assign(pixels, pixels + (size_t)width * height * 4);
+			stbi_image_free(pixels);
+			entry.width = width;
+			entry.height = height;
+		}
+		else {
+			std::ifstream in(source.path, std::ios::binary);
+			blob.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+			if (source.kind == ASSET_JSON) {
+				blob = json::to_msgpack(json::parse(blob.begin(), blob.end()));
+			}
+		}
+
+		uint64_t padding = (SKYPACK_ALIGNMENT - offset % SKYPACK_ALIGNMENT) % SKYPACK_ALIGNMENT;
+		out.write(std::string(padding, '\0').data(), padding);
+		offset += padding;
+		entry.offset = offset;
+		entry.size = blob.size();
+		out.write((const char*)blob.data(), blob.size());
+		offset += blob.size();
+	}
+	out.seekp(sizeof(header));
+	out.write((const char*)entries.data(), sizeof(SkypackEntry) * entries.size());
+	out.close();
+	if (!out) {
+		std::cerr << "ERROR: could not write " << temp_path << std::endl;
+		return false;
+	}
+
+	fs::rename(temp_path, pack_path, error);
+	if (error) {
+		std::cerr << "ERROR: could not write " << pack_path << ": " << error.message() << std::endl;
+		return false;
+	}
+	std::cout << "Packed " << sources.size() << " assets into " << pack_path << " (" << offset / (1024 * 1024) << " MB)" << std::endl;
+	return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+#include "mapped_file.hpp"
+#include "../../ext/nlohmann/json.hpp"
+
+// The asset pack (data/cache/assets.skypack) bundles the files the game loads from data/ into one
+// memory-mapped file, already in the form they are used in:
+//   textures   png decoded to RGBA8, uploaded straight from the mapping
+//   json       converted to MessagePack
+//   audio/fonts stored as is, opened from memory
+// Layout: SkypackHeader, SkypackEntry[entry_count] sorted by path, then the 16 byte aligned blobs.
+// Maps are not packed, they already load from their own compiled form (see map_compiler.hpp).
+const uint32_t SKYPACK_VERSION = 1;
+
+enum ASSET_KIND : uint32_t {
+	ASSET_RAW = 0,
+	ASSET_TEXTURE = 1,
+	ASSET_JSON = 2
+};
+
+struct SkypackHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t reserved;
+};
+
+struct SkypackEntry {
+	// relative to data/, with forward slashes
+	char path[96];
+	uint32_t kind;
+	uint32_t width;
+	uint32_t height;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct AssetView {
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	int width = 0;
+	int height = 0;
+};
+
+// Read-only view over the mapped pack. Loaders ask it first and fall back to the file on disk
+// when there is no pack, the file is not in it, or the file changed after the pack was built.
+class AssetPack {
+public:
+	bool open(const std::string& path);
+	void close();
+	bool is_open() const { return file.is_open(); }
+
+	// finds the packed form of the file at path (as passed to the loader, e.g. textures_path(...))
+	bool find(const std::string& path, ASSET_KIND kind, AssetView& view) const;
+
+	static std::string pack_path();
+
+private:
+	MappedFile file;
+	const SkypackHeader* header = nullptr;
+	const SkypackEntry* entries = nullptr;
+	std::filesystem::file_time_type pack_time;
+};
+
+extern AssetPack asset_pack;
+
+// reads a json file through the pack
+nlohmann::json load_json(const std::string& path);
+
+class AssetPacker {
+public:
+	// --pack-assets: writes the asset pack from data/ and exits with exit_code,
+	// EXIT_FAILURE if any asset could not be read or the pack could not be written
+	static bool run_from_args(int argc, char* argv[], int& exit_code);
+
+	static bool pack(const std::string& pack_path);
+};
@@ -0,0 +1,229 @@
+#include "benchmark.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <cmath>
+
+#include "../common.hpp"
+#include "../tinyECS/registry.hpp"
+#include "../systems/ai_system.hpp"
+#include "../systems/enemy_system.hpp"
+#include "../systems/world_init.hpp"
+#include "nav_grid.hpp"
+#include "spatial_grid.hpp"
+#include "map_compiler.hpp"
+#include "map_parser.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+bool Benchmark::run_from_args(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--benchmark-ai") {
+			ai_step();
+			return true;
+		}
+		if (std::string(argv[i]) == "--benchmark-room-load") {
+			room_load();
+			return true;
+		}
+	}
+	return false;
+}
+
+// 20x18 room, the size of the city maps, walled in with a few pillars
+static NavGrid create_benchmark_grid() {
+	NavGrid grid;
+	grid.resize(20, 18);
+	for (int y = 0; y < grid.height; y++) {
+		for (int x = 0; x < grid.width; x++) {
+			bool border = x == 0 || y == 0 || x == grid.width - 1 || y == grid.height - 1;
+			bool pillar = (x % 5 == 2 || x % 5 == 3) && (y % 6 == 2 || y % 6 == 3);
+			grid.blocked[grid.index(x, y)] = border || pillar;
+		}
+	}
+	return grid;
+}
+
+// links the corners of every 2x2 pillar of the benchmark grid into an obstacle graph, as the
+// corner graphs PATHING_GRAPH walks. Corners sit a quarter tile out, in the walkable cells around the pillar.
+static void create_pillar_graphs(const NavGrid& grid, AISystem& ai_system) {
+	const float margin = BASE_TILE_SIZE_WIDTH / 4.f;
+	for (int y = 1; y < grid.height - 1; y++) {
+		for (int x = 1; x < grid.width - 1; x++) {
+			// top left cell of a pillar in create_benchmark_grid
+			if (x % 5 != 2 || y % 6 != 2) {
+				continue;
+			}
+			vec2 top_left = { x * BASE_TILE_SIZE_WIDTH - margin, y * BASE_TILE_SIZE_HEIGHT - margin };
+			vec2 bottom_right = { (x + 2) * BASE_TILE_SIZE_WIDTH + margin, (y + 2) * BASE_TILE_SIZE_HEIGHT + margin };
+			PathNode* node0 = ai_system.create_pathNode(top_left);
+			PathNode* node1 = ai_system.create_pathNode({ bottom_right.x, top_left.y });
+			PathNode* node2 = ai_system.create_pathNode(bottom_right);
+			PathNode* node3 = ai_system.create_pathNode({ top_left.x, bottom_right.y });
+			AISystem::link_nodes(node0, node1);
+			AISystem::link_nodes(node1, node2);
+			AISystem::link_nodes(node2, node3);
+			AISystem::link_nodes(node3, node0);
+			Entity graph_entity;
+			registry.pathGraphs.emplace(graph_entity, node0);
+		}
+	}
+}
+
+// times AISystem::step in one pathing mode with enemy_count enemies chasing a circling player
+static void time_ai_step(const NavGrid& grid, PATHING_MODE mode, const char* mode_name, int enemy_count) {
+	const int frames = 2000;
+	const float frame_ms = 1000.f / 60.f;
+
+	registry.clear_all_components();
+
+	EnemySystem enemy_system;
+	AISystem ai_system;
+	ai_system.init(&enemy_system);
+	ai_system.pathing_mode = mode;
+	if (mode == PATHING_GRAPH) {
+		// without a nav grid line of sight is tested against the obstacle edges, so every step
+		// goes through get_path_to_player, intersects_with_graph and update_node_position_edges
+		create_pillar_graphs(grid, ai_system);
+	}
+	else {
+		ai_system.set_nav_grid(grid);
+	}
+
+	Entity player_entity;
+	registry.players.emplace(player_entity);
+	registry.positions.emplace(player_entity);
+	vec2 room_center = grid.cell_center(grid.index(grid.width / 2, grid.height / 2));
+
+	// spread enemies over the walkable cells with a fixed stride so every run is identical.
+	// The stride is coprime with the 360 cells, so every cell comes up, and far from 1 either
+	// way, so consecutive enemies land apart instead of in neighbouring cells.
+	const int stride = 97;
+	int cell = 0;
+	for (int i = 0; i < enemy_count; i++) {
+		do {
+			cell = (cell + stride) % (grid.width * grid.height);
+		} while (grid.blocked[cell]);
+		Entity enemy_entity;
+		Enemy& enemy = registry.enemies.emplace(enemy_entity);
+		enemy.speed = BASE_TILE_SIZE_HEIGHT * 1.75f;
+		// never in attack range, even on the player's exact position, so the benchmark measures
+		// perception and pathing only
+		enemy.attack_range = -1.f;
+		registry.positions.emplace(enemy_entity).position = grid.cell_center(cell);
+		registry.velocities.emplace(enemy_entity);
+	}
+
+	float total_us = 0.f;
+	float worst_us = 0.f;
+	for (int frame = 0; frame < frames; frame++) {
+		// circle the player around the room so paths keep changing
+		float angle = frame * 0.01f;
+		registry.positions.get(player_entity).position = room_center + vec2(cosf(angle), sinf(angle)) * (BASE_TILE_SIZE_WIDTH * 6.f);
+		// normally rebuilt by PhysicsSystem, kept out of the timing
+		spatial_grid.rebuild();
+
+		auto start = Clock::now();
+		ai_system.step(frame_ms);
+		float us = (float)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / 1000.f;
+		total_us += us;
+		worst_us = max(worst_us, us);
+	}
+	std::cout << "AISystem::step (" << mode_name << ") with " << enemy_count << " enemies: "
+		<< total_us / frames << " us avg, " << worst_us << " us worst over " << frames << " frames" << std::endl;
+
+	// path nodes are heap allocated and not freed with their components
+	for (PathNode* node : registry.pathNodes.components) {
+		delete node;
+	}
+	registry.clear_all_components();
+}
+
+void Benchmark::ai_step() {
+	NavGrid grid = create_benchmark_grid();
+	for (int enemy_count : { 10, 50, 200 }) {
+		time_ai_step(grid, PATHING_FLOW_FIELD, "flow field", enemy_count);
+	}
+	for (int enemy_count : { 10, 50, 200 }) {
+		time_ai_step(grid, PATHING_ASYNC_GRID, "async grid", enemy_count);
+	}
+	for (int enemy_count : { 10, 50, 200 }) {
+		time_ai_step(grid, PATHING_GRAPH, "obstacle graph", enemy_count);
+	}
+}
+
+// the containers a room fills, swapped for empty ones so every load pays for its own growth
+static void reset_room_containers() {
+	registry.clear_all_components();
+	registry.textureinfos = ComponentContainer<TextureInfo>();
+	registry.positions = ComponentContainer<Position>();
+	registry.mapTiles = ComponentContainer<MapTile>();
+	registry.collidables = ComponentContainer<Collidable>();
+	registry.entrance = ComponentContainer<Entrance>();
+	registry.enemySpawns = ComponentContainer<EnemySpawn>();
+	registry.itemSpawns = ComponentContainer<ItemSpawn>();
+	registry.lightSources = ComponentContainer<LightSource>();
+}
+
+// room creation as it was before the bulk spawn, one createMapTile per tile
+static void create_room_per_tile(const CompiledMap& map, GLuint* handles) {
+	int width = map.width();
+	for (int layer = 0; layer < map.layer_count(); layer++) {
+		const uint32_t* tiles = map.layer(layer);
+		float layer_num = (float)map.layer_number(layer);
+		for (int tile_index = 0; tile_index < width * map.height(); tile_index++) {
+			if (tiles[tile_index] == 0) {
+				continue;
+			}
+			const SkymapGid& tile = map.gid(tiles[tile_index]);
+			vec2 position = { (tile_index % width) * BASE_TILE_SIZE_WIDTH + (BASE_TILE_SIZE_WIDTH / 2.0f),
+				(tile_index / width) * BASE_TILE_SIZE_HEIGHT + (BASE_TILE_SIZE_HEIGHT / 2.0f) };
+			if (tile.flags & MAP_TILE_ENEMY_SPAWN) {
+				createEnemySpawn(position);
+			}
+			else if (tile.flags & MAP_TILE_ITEM_SPAWN) {
+				createItemSpawn(position);
+			}
+			else if (tile.flags & MAP_TILE_LIGHT) {
+				registry.lightSources.get(createLightSource(position)).radius = 750.0f;
+			}
+			else {
+				createMapTile(position, layer_num, { tile.top_left[0], tile.top_left[1] }, { tile.bottom_right[0], tile.bottom_right[1] },
+					tile.flags & MAP_TILE_COLLIDABLE, tile.flags & MAP_TILE_ENTRANCE, tile.flags & MAP_TILE_EXIT, tile.tileset, handles);
+			}
+		}
+	}
+}
+
+void Benchmark::room_load() {
+	const int loads = 500;
+	MapLoader loader;
+	for (const char* name : { "map/city_1.json", "map/city_5.json", "map/boss_room.json" }) {
+		CompiledMap map;
+		if (!MapCompiler::load(textures_path(name), map)) {
+			std::cerr << "ERROR: could not load " << name << std::endl;
+			continue;
+		}
+		// texture ids are only stored, no GL context is needed
+		std::vector<GLuint> handles(map.tileset_count(), 0);
+
+		float per_tile_us = 0.f;
+		float bulk_us = 0.f;
+		size_t entity_count = 0;
+		for (int i = 0; i < loads; i++) {
+			reset_room_containers();
+			auto start = Clock::now();
+			create_room_per_tile(map, handles.data());
+			per_tile_us += (float)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / 1000.f;
+
+			reset_room_containers();
+			start = Clock::now();
+			loader.createRoomEntities(map, handles.data());
+			bulk_us += (float)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / 1000.f;
+			entity_count = registry.positions.size();
+		}
+		std::cout << name << " (" << entity_count << " entities): per tile " << per_tile_us / loads
+			<< " us avg, bulk " << bulk_us / loads << " us avg over " << loads << " loads" << std::endl;
+	}
+	reset_room_containers();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+// Headless micro benchmarks, run from the command line instead of the game:
+//   SkySeeker --benchmark-ai
+//   SkySeeker --benchmark-room-load
+class Benchmark {
+public:
+	// returns true if args named a benchmark, which has then been run
+	static bool run_from_args(int argc, char* argv[]);
+
+	// times AISystem::step on a synthetic room with 10, 50 and 200 chasing enemies, in each pathing mode
+	static void ai_step();
+
+	// times creating a room's entities one tile at a time against MapLoader::createRoomEntities
+	static void room_load();
+};
@@ -0,0 +1,106 @@
+#include "fixed_timestep.hpp"
+
+#include <cassert>
+
+const float FIXED_TIMESTEP_DEFAULT_TICK_RATE = 60.f;
+const int FIXED_TIMESTEP_MAX_TICKS = 5;
+// anything moving further than this in one tick was placed, not moved (room change, respawn)
+const float FIXED_TIMESTEP_MAX_BLEND_DISTANCE = BASE_TILE_SIZE_WIDTH * 2.f;
+
+FixedTimestep::FixedTimestep() {
+	set_tick_rate(FIXED_TIMESTEP_DEFAULT_TICK_RATE);
+}
+
+void FixedTimestep::set_tick_rate(float ticks_per_second) {
+	assert(ticks_per_second > 0.f);
+	tick_length_ms = 1000.f / ticks_per_second;
+}
+
+float FixedTimestep::tick_ms() const {
+	return tick_length_ms;
+}
+
+int FixedTimestep::advance(float elapsed_ms) {
+	accumulator_ms += elapsed_ms;
+	int ticks = (int)(accumulator_ms / tick_length_ms);
+	if (ticks > FIXED_TIMESTEP_MAX_TICKS) {
+		ticks = FIXED_TIMESTEP_MAX_TICKS;
+		accumulator_ms = tick_length_ms * ticks;
+	}
+	accumulator_ms -= tick_length_ms * ticks;
+	return ticks;
+}
+
+void FixedTimestep::reset() {
+	accumulator_ms = 0.f;
+	previous.clear();
+	has_previous = false;
+}
+
+void FixedTimestep::begin_tick() {
+	previous.clear();
+	for (Entity entity : registry.velocities.entities) {
+		if (registry.positions.has(entity)) {
+			previous.push_back({ entity, registry.positions.get(entity).position });
+		}
+	}
+	// particles move themselves without a Velocity
+	for (Entity entity : registry.particles.entities) {
+		previous.push_back({ entity, registry.positions.get(entity).position });
+	}
+	previous_camera = registry.screenStates.components[0].camera_position;
+	has_previous = true;
+}
+
+static bool can_blend(vec2 from, vec2 to) {
+	vec2 difference = to - from;
+	return dot(difference, difference) <= FIXED_TIMESTEP_MAX_BLEND_DISTANCE * FIXED_TIMESTEP_MAX_BLEND_DISTANCE;
+}
+
+void FixedTimestep::apply_interpolation() {
+	if (!has_previous) {
+		return;
+	}
+	float alpha = accumulator_ms / tick_length_ms;
+	simulated.clear();
+	for (const Snapshot& snapshot : previous) {
+		// removed during the tick
+		if (!registry.positions.has(snapshot.entity)) {
+			continue;
+		}
+		Position& position = registry.positions.get(snapshot.entity);
+		if (!can_blend(snapshot.position, position.position)) {
+			continue;
+		}
+		simulated.push_back({ snapshot.entity, position.position });
+		position.position = mix(snapshot.position, position.position, alpha);
+	}
+
+	// the healthbar is placed relative to the camera, so it moves with it
+	ScreenState& screen = registry.screenStates.components[0];
+	simulated_camera = screen.camera_position;
+	if (can_blend(previous_camera, screen.camera_position)) {
+		screen.camera_position = mix(previous_camera, screen.camera_position, alpha);
+		vec2 camera_offset = screen.camera_position - simulated_camera;
+		for (Entity entity : registry.healthbar.entities) {
+			Position& position = registry.positions.get(entity);
+			simulated.push_back({ entity, position.position });
+			position.position += camera_offset;
+		}
+	}
+	interpolated = true;
+}
+
+void FixedTimestep::restore_simulation() {
+	if (!interpolated) {
+		return;
+	}
+	for (const Snapshot& snapshot : simulated) {
+		// the screens may remove entities while drawing
+		if (registry.positions.has(snapshot.entity)) {
+			registry.positions.get(snapshot.entity).position = snapshot.position;
+		}
+	}
+	registry.screenStates.components[0].camera_position = simulated_camera;
+	interpolated = false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../tinyECS/registry.hpp"
+#include <vector>
+
+// Fixed rate simulation clock with interpolated rendering.
+// The main loop feeds it each frame's time and runs as many ticks as have accumulated, each
+// advancing the simulation by exactly tick_ms(), so results no longer depend on the frame rate.
+// A frame usually lands between two ticks: apply_interpolation blends moving entities and the
+// camera from where they were at the start of the last tick toward where they are now, and
+// restore_simulation puts the simulated values back once the frame is drawn.
+class FixedTimestep {
+public:
+	FixedTimestep();
+
+	// ticks_per_second must be above 0
+	void set_tick_rate(float ticks_per_second);
+	float tick_ms() const;
+
+	// adds a frame's time and returns how many ticks to run. After a very slow frame the
+	// backlog beyond the tick limit is dropped, so the game slows down instead of spiralling.
+	int advance(float elapsed_ms);
+
+	// forgets accumulated time and captured positions, while the game is paused for instance
+	void reset();
+
+	// call before each tick, remembers where the moving entities start from
+	void begin_tick();
+
+	void apply_interpolation();
+	void restore_simulation();
+
+private:
+	struct Snapshot {
+		Entity entity;
+		vec2 position;
+	};
+
+	float tick_length_ms;
+	float accumulator_ms = 0.f;
+
+	// at the start of the last tick
+	std::vector<Snapshot> previous;
+	vec2 previous_camera = { 0.f, 0.f };
+	bool has_previous = false;
+
+	// simulated values replaced by apply_interpolation
+	std::vector<Snapshot> simulated;
+	vec2 simulated_camera = { 0.f, 0.f };
+	bool interpolated = false;
+};
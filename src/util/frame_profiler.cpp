@@ -0,0 +1,76 @@
+#include "frame_profiler.hpp"
+#include "../tinyECS/registry.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+FrameProfiler frame_profiler;
+
+const float FRAME_PROFILER_REPORT_MS = 2000.f;
+
+void FrameProfiler::begin_frame() {
+	if (!enabled) {
+		return;
+	}
+	frame_start = Clock::now();
+	last_mark = frame_start;
+}
+
+void FrameProfiler::mark(const char* name) {
+	if (!enabled) {
+		return;
+	}
+	Clock::time_point now = Clock::now();
+	float ms = std::chrono::duration_cast<std::chrono::microseconds>(now - last_mark).count() / 1000.f;
+	last_mark = now;
+	record(name, ms);
+}
+
+void FrameProfiler::record(const char* name, float ms) {
+	if (!enabled) {
+		return;
+	}
+	// a handful of sections named by string literals, so comparing pointers is enough
+	Section* section = nullptr;
+	for (Section& s : sections) {
+		if (s.name == name) {
+			section = &s;
+			break;
+		}
+	}
+	if (section == nullptr) {
+		sections.push_back({ name });
+		section = &sections.back();
+	}
+	section->total_ms += ms;
+	section->worst_ms = std::max(section->worst_ms, ms);
+}
+
+void FrameProfiler::end_frame() {
+	if (!enabled) {
+		return;
+	}
+	float frame_ms = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - frame_start).count() / 1000.f;
+	total_frame_ms += frame_ms;
+	worst_frame_ms = std::max(worst_frame_ms, frame_ms);
+	frames++;
+	if (total_frame_ms >= FRAME_PROFILER_REPORT_MS) {
+		report();
+	}
+}
+
+void FrameProfiler::report() {
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Frame " << total_frame_ms / frames << " ms avg, " << worst_frame_ms << " ms worst over " << frames
+		<< " frames (" << registry.enemies.size() << " enemies, " << registry.positions.size() << " positions)" << std::endl;
+	for (Section& section : sections) {
+		std::cout << "  " << std::setw(10) << section.name << ": " << section.total_ms / frames << " ms avg, "
+			<< section.worst_ms << " ms worst" << std::endl;
+		section.total_ms = 0.f;
+		section.worst_ms = 0.f;
+	}
+	std::cout << std::defaultfloat;
+	total_frame_ms = 0.f;
+	worst_frame_ms = 0.f;
+	frames = 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Per-system frame time breakdown for load testing (--profile, or --horde).
+// The main loop calls mark(name) after each step, which charges the time since the previous
+// mark to that section. Systems run by the SystemScheduler are recorded with their own durations. Averages and worst cases are printed to stdout every couple of seconds.
+class FrameProfiler {
+public:
+	bool enabled = false;
+
+	void begin_frame();
+
+	// charges the time since the last mark (or begin_frame) to the named section
+	void mark(const char* name);
+
+	// charges ms to the named section without moving the mark, for work timed elsewhere (e.g. on a worker)
+	void record(const char* name, float ms);
+
+	void end_frame();
+
+private:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Section {
+		const char* name;
+		float total_ms = 0.f;
+		float worst_ms = 0.f;
+	};
+
+	void report();
+
+	std::vector<Section> sections;
+	Clock::time_point frame_start;
+	Clock::time_point last_mark;
+	float total_frame_ms = 0.f;
+	float worst_frame_ms = 0.f;
+	int frames = 0;
+};
+
+extern FrameProfiler frame_profiler;
@@ -0,0 +1,100 @@
+#include "job_graph.hpp"
+#include "thread_pool.hpp"
+#include <cassert>
+#include <iostream>
+#include <iomanip>
+
+int JobGraph::add(const char* name, std::function<void()> job, std::vector<int> after) {
+	return add_job(name, std::move(job), false, after);
+}
+
+int JobGraph::add_main(const char* name, std::function<void()> job, std::vector<int> after) {
+	return add_job(name, std::move(job), true, after);
+}
+
+int JobGraph::add_job(const char* name, std::function<void()> work, bool on_main, const std::vector<int>& after) {
+	int id = (int)jobs.size();
+	jobs.push_back({ name, std::move(work), on_main });
+	for (int dependency : after) {
+		// ids only refer to earlier jobs, so the graph cannot have cycles
+		assert(dependency >= 0 && dependency < id && "Job depends on an unknown job");
+		jobs[dependency].dependents.push_back(id);
+		jobs[id].dependency_count++;
+	}
+	return id;
+}
+
+float JobGraph::ms_since_start() const {
+	return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() / 1000.f;
+}
+
+void JobGraph::make_ready(int id) {
+	if (jobs[id].on_main) {
+		ready_main.push_back(id);
+		done_cv.notify_all();
+	}
+	else {
+		thread_pool.submit([this, id]() { execute(id); });
+	}
+}
+
+void JobGraph::execute(int id) {
+	Job& job = jobs[id];
+	job.start_ms = ms_since_start();
+	job.work();
+	job.duration_ms = ms_since_start() - job.start_ms;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int dependent : job.dependents) {
+		if (--jobs[dependent].waiting_on == 0) {
+			make_ready(dependent);
+		}
+	}
+	unfinished--;
+	// notified under the lock, run() may return and destroy the graph as soon as it sees the count
+	done_cv.notify_all();
+}
+
+void JobGraph::run() {
+	start = Clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		unfinished = (int)jobs.size();
+		for (Job& job : jobs) {
+			job.waiting_on = job.dependency_count;
+		}
+		for (int id = 0; id < (int)jobs.size(); id++) {
+			if (jobs[id].waiting_on == 0) {
+				make_ready(id);
+			}
+		}
+	}
+	while (true) {
+		int id;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done_cv.wait(lock, [this] { return unfinished == 0 || ready_main.size() > 0; });
+			if (ready_main.size() == 0) {
+				break;
+			}
+			id = ready_main.front();
+			ready_main.pop_front();
+		}
+		execute(id);
+	}
+	total_ms = ms_since_start();
+}
+
+void JobGraph::print_timings(const char* title) const {
+	float serial_ms = 0.f;
+	for (const Job& job : jobs) {
+		serial_ms += job.duration_ms;
+	}
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << title << ": " << total_ms << " ms (" << serial_ms << " ms of work)" << std::endl;
+	for (const Job& job : jobs) {
+		std::cout << "  " << std::setw(16) << job.name << ": " << std::setw(7) << job.duration_ms << " ms, started at "
+			<< job.start_ms << " ms on " << (job.on_main ? "main" : "worker") << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
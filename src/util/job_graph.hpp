@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+// Small dependency graph of jobs, used to load assets in parallel at startup and to run
+// the systems of a simulation tick (see system_scheduler.hpp). run() can be called again.
+// Worker jobs go to the shared thread pool as soon as everything they depend on has finished.
+// Main jobs run on the thread that calls run(), for work that needs the GL context or SDL init.
+// Every job is timed, so the graph can print where startup time went.
+class JobGraph {
+public:
+	// adds a job for the thread pool that starts once every job in after has finished, returns its id
+	int add(const char* name, std::function<void()> job, std::vector<int> after = {});
+
+	// same, but the job runs on the thread calling run()
+	int add_main(const char* name, std::function<void()> job, std::vector<int> after = {});
+
+	// runs every job and returns once all of them have finished
+	void run();
+
+	// prints each job's start and duration relative to the start of run()
+	void print_timings(const char* title) const;
+
+	int size() const { return (int)jobs.size(); }
+	const char* name(int id) const { return jobs[id].name; }
+	// how long the job took in the last run()
+	float duration_ms(int id) const { return jobs[id].duration_ms; }
+
+private:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Job {
+		const char* name;
+		std::function<void()> work;
+		bool on_main;
+		std::vector<int> dependents;
+		int dependency_count = 0;
+		int waiting_on = 0;
+		float start_ms = 0.f;
+		float duration_ms = 0.f;
+	};
+
+	int add_job(const char* name, std::function<void()> work, bool on_main, const std::vector<int>& after);
+	void execute(int id);
+	// queues a job whose dependencies are done, called with lock held
+	void make_ready(int id);
+	float ms_since_start() const;
+
+	std::vector<Job> jobs;
+	Clock::time_point start;
+	float total_ms = 0.f;
+
+	std::mutex mutex;
+	std::condition_variable done_cv;
+	std::deque<int> ready_main;
+	int unfinished = 0;
+};
@@ -0,0 +1,292 @@
+#include "map_compiler.hpp"
+#include "../common.hpp"
+#include "../../ext/nlohmann/json.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <thread>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+bool CompiledMap::open(const std::string& path) {
+	close();
+	if (!file.open(path) || file.size() < sizeof(SkymapHeader)) {
+		return false;
+	}
+	const uint8_t* bytes = file.data();
+	header = (const SkymapHeader*)bytes;
+	if (memcmp(header->magic, "SKYM", 4) != 0 || header->version != SKYMAP_VERSION) {
+		close();
+		return false;
+	}
+	size_t cells = (size_t)header->width * header->height;
+	size_t offset = sizeof(SkymapHeader);
+	tilesets = (const SkymapTileset*)(bytes + offset);
+	offset += sizeof(SkymapTileset) * header->tileset_count;
+	gids = (const SkymapGid*)(bytes + offset);
+	offset += sizeof(SkymapGid) * header->gid_count;
+	layer_numbers = (const uint32_t*)(bytes + offset);
+	offset += sizeof(uint32_t) * header->layer_count;
+	layers = (const uint32_t*)(bytes + offset);
+	offset += sizeof(uint32_t) * header->layer_count * cells;
+	blocked = bytes + offset;
+	offset += (cells + 7) / 8;
+	// a truncated write would leave the sections pointing past the end
+	if (offset > file.size()) {
+		close();
+		return false;
+	}
+	// checked once here so room construction can index the gid table without bounds checks
+	for (size_t i = 0; i < header->layer_count * cells; i++) {
+		if (layers[i] >= header->gid_count) {
+			close();
+			return false;
+		}
+	}
+	for (uint32_t gid = 0; gid < header->gid_count; gid++) {
+		if (gids[gid].tileset >= header->tileset_count && gid != 0) {
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void CompiledMap::close() {
+	file.close();
+	header = nullptr;
+}
+
+std::string MapCompiler::compiled_path(const std::string& map_path) {
+	return data_path() + "/cache/maps/" + fs::path(map_path).stem().string() + ".skymap";
+}
+
+static std::string tileset_json_path(const std::string& name) {
+	return textures_path("map/" + name + ".json");
+}
+
+// tilesets reference their .tsx, the exported .json and .png sit next to it under the same name
+static std::string tileset_name(const std::string& source) {
+	std::istringstream s(source);
+	std::string name;
+	std::getline(s, name, '.');
+	return name;
+}
+
+// Tiled keeps custom properties in a fixed order: Collision, Enemy Spawn, Entrance, Exit, Item Spawn, Light
+static bool tile_property(const json& tile, size_t index) {
+	if (!tile.contains("properties") || index >= tile["properties"].size()) {
+		return false;
+	}
+	return tile["properties"][index]["value"] == true;
+}
+
+static uint8_t tile_flags(const json& tile) {
+	uint8_t flags = 0;
+	if (tile_property(tile, 0)) {
+		flags |= MAP_TILE_COLLIDABLE;
+	}
+	else if (tile_property(tile, 1)) {
+		flags |= MAP_TILE_ENEMY_SPAWN;
+	}
+	if (tile_property(tile, 2)) {
+		flags |= MAP_TILE_ENTRANCE;
+	}
+	else if (tile_property(tile, 3)) {
+		flags |= MAP_TILE_EXIT;
+	}
+	else if (tile_property(tile, 4)) {
+		flags |= MAP_TILE_ITEM_SPAWN;
+	}
+	else if (tile_property(tile, 5)) {
+		flags |= MAP_TILE_LIGHT;
+	}
+	return flags;
+}
+
+bool MapCompiler::compile(const std::string& map_path, const std::string& skymap_path) {
+	std::ifstream f(map_path);
+	if (!f) {
+		std::cerr << "ERROR: could not open map " << map_path << std::endl;
+		return false;
+	}
+	json data = json::parse(f);
+	int width = data["width"];
+	int height = data["height"];
+	int tilewidth = data["tilewidth"];
+	int tileheight = data["tileheight"];
+	size_t cells = (size_t)width * height;
+
+	// gid table: every tile of every tileset, indexed by its gid in this map
+	std::vector<SkymapTileset> tilesets;
+	std::vector<SkymapGid> gids(1, SkymapGid());
+	for (const json& tileset : data["tilesets"]) {
+		SkymapTileset compiled_tileset = {};
+		std::string name = tileset_name(tileset["source"]);
+		strncpy(compiled_tileset.name, name.c_str(), sizeof(compiled_tileset.name) - 1);
+
+		std::ifstream s(tileset_json_path(name));
+		if (!s) {
+			std::cerr << "ERROR: could not open tileset " << tileset_json_path(name) << std::endl;
+			return false;
+		}
+		json tileset_json = json::parse(s);
+		int first_gid = tileset["firstgid"];
+		int columns = tileset_json["columns"];
+		int tile_count = tileset_json["tilecount"];
+		float image_width = tileset_json["imagewidth"];
+		float image_height = tileset_json["imageheight"];
+
+		if ((int)gids.size() < first_gid + tile_count) {
+			gids.resize(first_gid + tile_count, SkymapGid());
+		}
+		for (int id = 0; id < tile_count; id++) {
+			SkymapGid& gid = gids[first_gid + id];
+			int tex_x = (id % columns) * tilewidth;
+			int tex_y = (id / columns) * tileheight;
+			gid.top_left[0] = tex_x / image_width;
+			gid.top_left[1] = tex_y / image_height;
+			gid.bottom_right[0] = (tex_x + tilewidth) / image_width;
+			gid.bottom_right[1] = (tex_y + tileheight) / image_height;
+			gid.tileset = (uint8_t)tilesets.size();
+			gid.flags = 0;
+		}
+		if (tileset_json.contains("tiles")) {
+			for (const json& tile : tileset_json["tiles"]) {
+				gids[first_gid + tile["id"].get<int>()].flags = tile_flags(tile);
+			}
+		}
+		tilesets.push_back(compiled_tileset);
+	}
+
+	std::vector<uint32_t> layer_numbers;
+	std::vector<uint32_t> layers;
+	std::vector<uint8_t> blocked((cells + 7) / 8, 0);
+	json map_layers = data["layers"];
+	for (int layer_num = 0; layer_num < (int)map_layers.size(); layer_num++) {
+		// object layers only held the old path graph nodes
+		if (map_layers[layer_num].contains("objects")) {
+			continue;
+		}
+		layer_numbers.push_back(layer_num);
+		const json& layer_data = map_layers[layer_num]["data"];
+		for (size_t cell = 0; cell < cells; cell++) {
+			uint32_t gid = cell < layer_data.size() ? layer_data[cell].get<uint32_t>() : 0;
+			if (gid >= gids.size()) {
+				std::cerr << "Map " << map_path << " uses unknown tile " << gid << std::endl;
+				gid = 0;
+			}
+			layers.push_back(gid);
+			// spawn, item and light markers never become map tiles, so they don't block
+			uint8_t flags = gids[gid].flags;
+			if (gid != 0 && (flags & MAP_TILE_COLLIDABLE) && !(flags & (MAP_TILE_ENEMY_SPAWN | MAP_TILE_ITEM_SPAWN | MAP_TILE_LIGHT))) {
+				blocked[cell / 8] |= (uint8_t)(1 << (cell % 8));
+			}
+		}
+	}
+
+	SkymapHeader header = {};
+	memcpy(header.magic, "SKYM", 4);
+	header.version = SKYMAP_VERSION;
+	header.width = width;
+	header.height = height;
+	header.tileset_count = (uint32_t)tilesets.size();
+	header.gid_count = (uint32_t)gids.size();
+	header.layer_count = (uint32_t)layer_numbers.size();
+
+	// written under a temporary name so a reader never maps a half written file,
+	// unique per thread since a room prefetch may import while the main thread does too
+	std::error_code error;
+	fs::create_directories(fs::path(skymap_path).parent_path(), error);
+	std::string temp_path = skymap_path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+		if (!out) {
+			std::cerr << "ERROR: could not write " << temp_path << std::endl;
+			return false;
+		}
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)tilesets.data(), sizeof(SkymapTileset) * tilesets.size());
+		out.write((const char*)gids.data(), sizeof(SkymapGid) * gids.size());
+		out.write((const char*)layer_numbers.data(), sizeof(uint32_t) * layer_numbers.size());
+		out.write((const char*)layers.data(), sizeof(uint32_t) * layers.size());
+		out.write((const char*)blocked.data(), blocked.size());
+	}
+	fs::rename(temp_path, skymap_path, error);
+	if (error) {
+		std::cerr << "ERROR: could not write " << skymap_path << ": " << error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool is_newer(const std::string& source, fs::file_time_type compiled_time) {
+	std::error_code error;
+	fs::file_time_type source_time = fs::last_write_time(source, error);
+	return !error && source_time > compiled_time;
+}
+
+bool MapCompiler::load(const std::string& map_path, CompiledMap& map) {
+	std::string skymap_path = compiled_path(map_path);
+	if (map.open(skymap_path)) {
+		std::error_code error;
+		fs::file_time_type compiled_time = fs::last_write_time(skymap_path, error);
+		bool stale = error || is_newer(map_path, compiled_time);
+		for (int i = 0; i < map.tileset_count() && !stale; i++) {
+			stale = is_newer(tileset_json_path(map.tileset(i).name), compiled_time);
+		}
+		if (!stale) {
+			return true;
+		}
+		map.close();
+	}
+
+	std::cout << "Importing " << map_path << std::endl;
+	if (!compile(map_path, skymap_path)) {
+		return false;
+	}
+	return map.open(skymap_path);
+}
+
+bool MapCompiler::run_from_args(int argc, char* argv[], int& exit_code) {
+	bool compile_maps = false;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == "--compile-maps") {
+			compile_maps = true;
+		}
+	}
+	if (!compile_maps) {
+		return false;
+	}
+
+	int compiled = 0;
+	int failed = 0;
+	for (const fs::directory_entry& entry : fs::directory_iterator(textures_path("map"))) {
+		if (entry.path().extension() != ".json") {
+			continue;
+		}
+		// tilesets are exported as json next to the maps
+		std::ifstream f(entry.path());
+		if (!json::parse(f).contains("layers")) {
+			continue;
+		}
+		std::string map_path = entry.path().string();
+		if (compile(map_path, compiled_path(map_path))) {
+			std::cout << map_path << " -> " << compiled_path(map_path) << std::endl;
+			compiled++;
+		}
+		else {
+			failed++;
+		}
+	}
+	std::cout << "Compiled " << compiled << " maps" << std::endl;
+	if (failed > 0) {
+		std::cerr << "ERROR: " << failed << " maps failed to compile" << std::endl;
+	}
+	exit_code = failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+	return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "mapped_file.hpp"
+
+// Compiled maps (.skymap) are flat binary images of a Tiled map and its tilesets, written to
+// data/cache/maps and memory-mapped at load. Layout, all sections back to back after the header:
+//   SkymapTileset[tileset_count]      tileset image names, in the map's tileset order
+//   SkymapGid[gid_count]              uv rect, tileset and MAP_TILE_FLAGS for every gid
+//   uint32_t[layer_count]             layer number of each tile layer (object layers are skipped)
+//   uint32_t[layer_count][w * h]      gid grid of each tile layer, 0 is empty
+//   uint8_t[(w * h + 7) / 8]          cells blocked for navigation, one bit each
+const uint32_t SKYMAP_VERSION = 1;
+
+enum MAP_TILE_FLAGS : uint8_t {
+	MAP_TILE_COLLIDABLE = 1 << 0,
+	MAP_TILE_ENEMY_SPAWN = 1 << 1,
+	MAP_TILE_ENTRANCE = 1 << 2,
+	MAP_TILE_EXIT = 1 << 3,
+	MAP_TILE_ITEM_SPAWN = 1 << 4,
+	MAP_TILE_LIGHT = 1 << 5
+};
+
+struct SkymapHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tileset_count;
+	uint32_t gid_count;
+	uint32_t layer_count;
+	uint32_t reserved;
+};
+
+struct SkymapTileset {
+	char name[64];
+};
+
+struct SkymapGid {
+	float top_left[2];
+	float bottom_right[2];
+	uint8_t tileset;
+	uint8_t flags;
+	uint16_t padding;
+};
+
+// read-only view over a mapped .skymap file
+class CompiledMap {
+public:
+	bool open(const std::string& path);
+	void close();
+
+	int width() const { return header->width; }
+	int height() const { return header->height; }
+	int tileset_count() const { return header->tileset_count; }
+	int gid_count() const { return header->gid_count; }
+	int layer_count() const { return header->layer_count; }
+
+	const SkymapTileset& tileset(int i) const { return tilesets[i]; }
+	const SkymapGid& gid(uint32_t gid) const { return gids[gid]; }
+	int layer_number(int layer) const { return layer_numbers[layer]; }
+	const uint32_t* layer(int layer) const { return layers + (size_t)layer * header->width * header->height; }
+	bool is_blocked(int cell) const { return (blocked[cell / 8] >> (cell % 8)) & 1; }
+
+private:
+	MappedFile file;
+	const SkymapHeader* header = nullptr;
+	const SkymapTileset* tilesets = nullptr;
+	const SkymapGid* gids = nullptr;
+	const uint32_t* layer_numbers = nullptr;
+	const uint32_t* layers = nullptr;
+	const uint8_t* blocked = nullptr;
+};
+
+class MapCompiler {
+public:
+	// --compile-maps: compiles every map in data/textures/map and exits with exit_code,
+	// EXIT_FAILURE if any map failed to compile
+	static bool run_from_args(int argc, char* argv[], int& exit_code);
+
+	// converts the Tiled map at map_path, plus its tilesets, into a .skymap at skymap_path
+	static bool compile(const std::string& map_path, const std::string& skymap_path);
+
+	// maps the compiled form of map_path, re-importing it first if it is missing, from an older
+	// format, or older than the map or any of its tilesets
+	static bool load(const std::string& map_path, CompiledMap& map);
+
+	static std::string compiled_path(const std::string& map_path);
+};
@@ -3,37 +3,77 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <memory>
+#include <future>
 #include "../ext/nlohmann/json.hpp"
 #include "../systems/ai_system.hpp"
+#include "../systems/render_system.hpp"
+#include "nav_grid.hpp"
+#include "map_compiler.hpp"
 
 using json = nlohmann::json;
 
+// a room read from disk with its tilesets decoded, left for the main thread to upload and instantiate
+struct PreparedMap {
+	std::string path;
+	bool loaded = false;
+	CompiledMap map;
+	std::vector<DecodedTexture> tilesets;
+};
+
 class MapLoader {
 	// Map Texture Handle so we can release them afterwards
 	std::vector<GLuint> map_texture_handles;
+	std::vector<std::string> map_texture_paths;
 	int level = 0;
 	std::string current_map = "";
+	// navigation grids derived from each map's collidable tiles, keyed by map path
+	std::unordered_map<std::string, NavGrid> nav_grids;
+	// the next room is chosen as soon as one is entered and prepared on a worker meanwhile
+	std::future<std::shared_ptr<PreparedMap>> next_map;
+
+	struct RoomTile {
+		int layer;
+		int cell;
+	};
+	// createRoomEntities scratch
+	std::vector<RoomTile> room_tiles;
 
 public:
+	~MapLoader();
+
 	void parseMaps(std::string path, RenderSystem* renderer, AISystem* ai);
 
 	void unloadCurrentMap(RenderSystem* renderer, AISystem* ai);
 
 	void loadNextMap(RenderSystem* renderer, AISystem* ai);
 
+	// blocks until the next room's prefetch, if any, is done. Its worker reads the asset pack,
+	// so this has to happen before shutdown tears down the globals it uses.
+	void waitForPrefetch();
+
 	int getLevel();
 
-private:
-	std::vector<std::string> getTilesetNames(json tilesets);
+	// navigation grid of the loaded map, empty before the first map is parsed
+	const NavGrid& getNavGrid();
+
+	// creates the tile, spawn and light entities of a compiled room, tiles in one bulk spawn
+	void createRoomEntities(const CompiledMap& map, GLuint* tileset_handles);
 
-	std::vector<int> getTilesetFirstGID(json tilesets);
+private:
+	// reads the compiled map and decodes its tileset images, safe to run on a worker thread.
+	// Tilesets in resident_textures are left for the texture cache to supply.
+	static std::shared_ptr<PreparedMap> prepareMap(std::string path, std::vector<std::string> resident_textures);
 
-	std::vector<std::vector<int>> getTileProperties(std::vector<std::string> ts_file_names, std::vector<int> ts_first_gid);
+	// uploads the tilesets and creates the room's entities
+	void buildMap(PreparedMap& prepared, RenderSystem* renderer, AISystem* ai);
 
-	std::vector<vec2> getTilesetSize(std::vector<std::string> ts_file_names);
+	std::string pickMap(int next_level);
 
-	std::vector<vec2> getTilesetDims(std::vector<std::string> ts_file_names);
+	static vec2 tile_position(int tile_index, int width);
 
+	void prefetchNextMap();
 };
 
 Entity createMapTile(vec2 pos, float layer, vec2 bottom_left, vec2 top_right, bool collision, bool is_entrance, bool is_exit, int tileset_index, GLuint* handles);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../common.hpp"
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+// Walkability grid of the current map, one cell per map tile.
+// Cell (0, 0) is the top left tile, matching the tile positions created by MapLoader.
+struct NavGrid {
+	int width = 0;
+	int height = 0;
+	std::vector<bool> blocked;
+
+	void resize(int w, int h) {
+		width = w;
+		height = h;
+		blocked.assign(w * h, false);
+	}
+
+	bool empty() const {
+		return width == 0 || height == 0;
+	}
+
+	bool in_bounds(int x, int y) const {
+		return x >= 0 && y >= 0 && x < width && y < height;
+	}
+
+	int index(int x, int y) const {
+		return y * width + x;
+	}
+
+	bool is_blocked(int x, int y) const {
+		return !in_bounds(x, y) || blocked[index(x, y)];
+	}
+
+	// returns the index of the cell containing pos, or -1 if pos is outside the map
+	int cell_of(vec2 pos) const {
+		int x = (int)floorf(pos.x / BASE_TILE_SIZE_WIDTH);
+		int y = (int)floorf(pos.y / BASE_TILE_SIZE_HEIGHT);
+		if (!in_bounds(x, y)) {
+			return -1;
+		}
+		return index(x, y);
+	}
+
+	vec2 cell_center(int cell) const {
+		return {
+			(cell % width) * BASE_TILE_SIZE_WIDTH + BASE_TILE_SIZE_WIDTH / 2.f,
+			(cell / width) * BASE_TILE_SIZE_HEIGHT + BASE_TILE_SIZE_HEIGHT / 2.f
+		};
+	}
+
+	// DDA raycast (Amanatides & Woo): walks every cell the segment a-b passes through,
+	// so the cost grows with the length of the ray rather than the number of obstacles.
+	// Positions outside the map count as blocked.
+	bool has_line_of_sight(vec2 a, vec2 b) const {
+		float ax = a.x / BASE_TILE_SIZE_WIDTH;
+		float ay = a.y / BASE_TILE_SIZE_HEIGHT;
+		float dx = b.x / BASE_TILE_SIZE_WIDTH - ax;
+		float dy = b.y / BASE_TILE_SIZE_HEIGHT - ay;
+		int x = (int)floorf(ax);
+		int y = (int)floorf(ay);
+		int steps = abs((int)floorf(ax + dx) - x) + abs((int)floorf(ay + dy) - y);
+
+		const float inf = std::numeric_limits<float>::infinity();
+		int step_x = dx > 0 ? 1 : -1;
+		int step_y = dy > 0 ? 1 : -1;
+		// distance along the ray, as a fraction of its length, between vertical / horizontal cell borders
+		float t_delta_x = dx != 0 ? fabsf(1.f / dx) : inf;
+		float t_delta_y = dy != 0 ? fabsf(1.f / dy) : inf;
+		// distance along the ray to the first vertical / horizontal cell border
+		float t_max_x = dx > 0 ? (x + 1 - ax) * t_delta_x : (dx < 0 ? (ax - x) * t_delta_x : inf);
+		float t_max_y = dy > 0 ? (y + 1 - ay) * t_delta_y : (dy < 0 ? (ay - y) * t_delta_y : inf);
+
+		for (int i = 0; i <= steps; i++) {
+			if (is_blocked(x, y)) {
+				return false;
+			}
+			if (t_max_x < t_max_y) {
+				t_max_x += t_delta_x;
+				x += step_x;
+			}
+			else {
+				t_max_y += t_delta_y;
+				y += step_y;
+			}
+		}
+		return true;
+	}
+};
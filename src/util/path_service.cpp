@@ -0,0 +1,175 @@
+#include "path_service.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+PathService::~PathService() {
+	wait_idle();
+}
+
+void PathService::set_grid(const NavGrid& grid) {
+	this->grid = std::make_shared<const NavGrid>(grid);
+	grid_version++;
+	waypoints.clear();
+}
+
+void PathService::request(unsigned int entity, vec2 start, vec2 goal) {
+	if (grid == nullptr || in_flight.find(entity) != in_flight.end()) {
+		return;
+	}
+	in_flight.insert(entity);
+	{
+		std::lock_guard<std::mutex> lock(results_mutex);
+		pending++;
+	}
+
+	std::shared_ptr<const NavGrid> search_grid = grid;
+	unsigned int version = grid_version;
+	thread_pool.submit([this, search_grid, entity, start, goal, version] {
+		vec2 waypoint = find_waypoint(*search_grid, start, goal);
+		// notify under the lock so wait_idle cannot return, and the service be destroyed,
+		// while this worker still touches it
+		std::lock_guard<std::mutex> lock(results_mutex);
+		back_results.push_back({ entity, waypoint, version });
+		pending--;
+		idle_cv.notify_all();
+	});
+}
+
+void PathService::collect() {
+	{
+		std::lock_guard<std::mutex> lock(results_mutex);
+		std::swap(front_results, back_results);
+	}
+	for (Result& result : front_results) {
+		in_flight.erase(result.entity);
+		if (result.grid_version == grid_version) {
+			waypoints[result.entity] = result.waypoint;
+		}
+	}
+	front_results.clear();
+}
+
+void PathService::forget_missing(const std::vector<Entity>& live) {
+	if (waypoints.size() <= live.size()) {
+		return;
+	}
+	std::unordered_map<unsigned int, vec2> kept;
+	kept.reserve(live.size());
+	for (Entity entity : live) {
+		auto it = waypoints.find(entity);
+		if (it != waypoints.end()) {
+			kept.insert(*it);
+		}
+	}
+	waypoints.swap(kept);
+}
+
+bool PathService::get_waypoint(unsigned int entity, vec2& waypoint) const {
+	auto it = waypoints.find(entity);
+	if (it == waypoints.end()) {
+		return false;
+	}
+	waypoint = it->second;
+	return true;
+}
+
+void PathService::wait_idle() {
+	std::unique_lock<std::mutex> lock(results_mutex);
+	idle_cv.wait(lock, [this] { return pending == 0; });
+}
+
+vec2 PathService::find_waypoint(const NavGrid& grid, vec2 start, vec2 goal) {
+	int start_cell = grid.cell_of(start);
+	int goal_cell = grid.cell_of(goal);
+	if (start_cell < 0 || goal_cell < 0 || start_cell == goal_cell || grid.has_line_of_sight(start, goal)) {
+		return goal;
+	}
+
+	// scratch buffers are per worker thread and reused between searches,
+	// entries are only valid while their stamp matches the current search
+	thread_local std::vector<float> cost;
+	thread_local std::vector<int> parent;
+	thread_local std::vector<unsigned int> seen;
+	thread_local std::vector<unsigned int> closed;
+	thread_local std::vector<std::pair<float, int>> open_set;
+	thread_local unsigned int stamp = 0;
+	size_t cell_count = grid.width * grid.height;
+	if (seen.size() != cell_count) {
+		cost.assign(cell_count, 0.f);
+		parent.assign(cell_count, -1);
+		seen.assign(cell_count, 0);
+		closed.assign(cell_count, 0);
+		stamp = 0;
+	}
+	stamp++;
+
+	int goal_x = goal_cell % grid.width;
+	int goal_y = goal_cell / grid.width;
+	// octile distance, exact on an open 8-connected grid
+	auto heuristic = [&](int x, int y) {
+		float dx = (float)abs(x - goal_x);
+		float dy = (float)abs(y - goal_y);
+		return max(dx, dy) + 0.41421356f * min(dx, dy);
+	};
+
+	auto greater_cost = std::greater<std::pair<float, int>>();
+	open_set.clear();
+	seen[start_cell] = stamp;
+	cost[start_cell] = 0.f;
+	parent[start_cell] = -1;
+	open_set.push_back({ heuristic(start_cell % grid.width, start_cell / grid.width), start_cell });
+	bool found = false;
+	while (open_set.size() > 0) {
+		std::pop_heap(open_set.begin(), open_set.end(), greater_cost);
+		int current = open_set.back().second;
+		open_set.pop_back();
+		if (closed[current] == stamp) {
+			continue;
+		}
+		closed[current] = stamp;
+		if (current == goal_cell) {
+			found = true;
+			break;
+		}
+
+		int x = current % grid.width;
+		int y = current / grid.width;
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				if ((dx == 0 && dy == 0) || grid.is_blocked(x + dx, y + dy)) {
+					continue;
+				}
+				// diagonal steps may not cut the corner of a blocked tile
+				if (dx != 0 && dy != 0 && (grid.is_blocked(x + dx, y) || grid.is_blocked(x, y + dy))) {
+					continue;
+				}
+				int next = grid.index(x + dx, y + dy);
+				float next_cost = cost[current] + ((dx != 0 && dy != 0) ? 1.41421356f : 1.f);
+				if (seen[next] != stamp || next_cost < cost[next]) {
+					seen[next] = stamp;
+					cost[next] = next_cost;
+					parent[next] = current;
+					open_set.push_back({ next_cost + heuristic(x + dx, y + dy), next });
+					std::push_heap(open_set.begin(), open_set.end(), greater_cost);
+				}
+			}
+		}
+	}
+	if (!found) {
+		return goal;
+	}
+
+	// walk back from the goal and stop at the first cell start can see,
+	// which skips the zig-zag of following every cell centre
+	int waypoint = goal_cell;
+	for (int cell = parent[goal_cell]; cell != -1 && cell != start_cell; cell = parent[cell]) {
+		if (grid.has_line_of_sight(start, grid.cell_center(waypoint))) {
+			break;
+		}
+		waypoint = cell;
+	}
+	return grid.cell_center(waypoint);
+}
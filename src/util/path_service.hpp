@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../common.hpp"
+#include "nav_grid.hpp"
+#include "../tinyECS/entity.hpp"
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+
+// Runs grid A* searches on the shared thread pool.
+// The main thread posts requests during a frame, workers write finished waypoints into a
+// back buffer, and collect() swaps it in at the start of the next frame, so a search never
+// blocks the simulation. Workers only see an immutable copy of the grid.
+class PathService {
+public:
+	~PathService();
+
+	// new map: later searches use grid, results still arriving for the old one are dropped
+	void set_grid(const NavGrid& grid);
+
+	// asks for the next waypoint from start toward goal, ignored while a search for entity is running
+	void request(unsigned int entity, vec2 start, vec2 goal);
+
+	// swaps in the waypoints finished since the last call
+	void collect();
+
+	// drops the waypoints of entities that are not in live, e.g. killed enemies. Only sweeps once
+	// there are more waypoints than live entities, so the map stays bounded by the live count.
+	void forget_missing(const std::vector<Entity>& live);
+
+	// latest finished waypoint for entity, false if none has arrived yet
+	bool get_waypoint(unsigned int entity, vec2& waypoint) const;
+
+	// blocks until every posted search has finished
+	void wait_idle();
+
+	// A* over grid from start's cell to goal's cell. Returns the centre of the furthest cell on
+	// the path that start can see, or goal itself if it is in sight or cannot be reached.
+	static vec2 find_waypoint(const NavGrid& grid, vec2 start, vec2 goal);
+
+private:
+	struct Result {
+		unsigned int entity;
+		vec2 waypoint;
+		unsigned int grid_version;
+	};
+
+	std::shared_ptr<const NavGrid> grid;
+	unsigned int grid_version = 0;
+
+	// main thread only
+	std::unordered_map<unsigned int, vec2> waypoints;
+	std::unordered_set<unsigned int> in_flight;
+	std::vector<Result> front_results;
+
+	// shared with the workers, guarded by results_mutex
+	std::mutex results_mutex;
+	std::condition_variable idle_cv;
+	std::vector<Result> back_results;
+	int pending = 0;
+};
@@ -0,0 +1,97 @@
+#include "render_thread.hpp"
+#include <utility>
+
+RenderThread render_thread;
+
+void RenderThread::start(GLFWwindow* window, std::function<void(const RenderSnapshot&)> draw) {
+	this->window = window;
+	this->draw = std::move(draw);
+	stopping = false;
+	has_pending = false;
+	// a context can only be current on one thread, the render thread picks it up with its first frame
+	glfwMakeContextCurrent(nullptr);
+	owner = ContextOwner::NONE;
+	running = true;
+	thread = std::thread(&RenderThread::thread_loop, this);
+}
+
+void RenderThread::stop() {
+	if (!running) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	cv.notify_all();
+	thread.join();
+	running = false;
+	if (owner != ContextOwner::MAIN) {
+		glfwMakeContextCurrent(window);
+		owner = ContextOwner::MAIN;
+	}
+}
+
+void RenderThread::submit(RenderSnapshot& snapshot) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (owner == ContextOwner::MAIN) {
+		glfwMakeContextCurrent(nullptr);
+		owner = ContextOwner::NONE;
+	}
+	cv.wait(lock, [this] { return !has_pending; });
+	std::swap(pending, snapshot);
+	has_pending = true;
+	cv.notify_all();
+}
+
+void RenderThread::claim_context() {
+	if (!running) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	if (owner == ContextOwner::MAIN) {
+		return;
+	}
+	// a waiting snapshot may name textures the main thread is about to delete, so it is skipped
+	has_pending = false;
+	main_wants_context = true;
+	cv.notify_all();
+	// the render thread lets go between frames
+	cv.wait(lock, [this] { return owner == ContextOwner::NONE; });
+	glfwMakeContextCurrent(window);
+	owner = ContextOwner::MAIN;
+	main_wants_context = false;
+}
+
+void RenderThread::thread_loop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		cv.wait(lock, [this] {
+			return stopping || (main_wants_context && owner == ContextOwner::RENDER) ||
+				(has_pending && !main_wants_context && owner != ContextOwner::MAIN);
+		});
+		if (owner == ContextOwner::RENDER && (main_wants_context || stopping)) {
+			glfwMakeContextCurrent(nullptr);
+			owner = ContextOwner::NONE;
+			cv.notify_all();
+		}
+		if (stopping) {
+			return;
+		}
+		if (!has_pending || main_wants_context) {
+			continue;
+		}
+
+		if (owner == ContextOwner::NONE) {
+			glfwMakeContextCurrent(window);
+			owner = ContextOwner::RENDER;
+		}
+		std::swap(drawing, pending);
+		has_pending = false;
+		cv.notify_all();
+
+		lock.unlock();
+		draw(drawing);
+		lock.lock();
+	}
+}
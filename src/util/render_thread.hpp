@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "../systems/render_snapshot.hpp"
+
+// Optional thread that owns the GL context during play and draws the snapshots the main thread
+// submits, so drawing and the buffer swap of frame N overlap with simulating frame N + 1
+// (--render-thread). At most one snapshot waits while another is drawn.
+// The main thread still uses GL for menus and for loading textures and shaders: claim_context()
+// waits for the frame being drawn and moves the context to the main thread until the next submit.
+// Every call except the draw callback is made from the main thread.
+class RenderThread {
+public:
+	// hands the window's context over to a new thread that calls draw for every submitted snapshot
+	void start(GLFWwindow* window, std::function<void(const RenderSnapshot&)> draw);
+
+	// waits for the frame being drawn and makes the context current on the main thread again
+	void stop();
+
+	bool is_running() const { return running; }
+
+	// queues snapshot for drawing, swapping it with an already drawn one to capture into next.
+	// Waits while the previous snapshot has not been picked up yet.
+	void submit(RenderSnapshot& snapshot);
+
+	// makes the context current on the main thread until the next submit, no-op when not running.
+	// A snapshot still waiting to be drawn is dropped.
+	void claim_context();
+
+private:
+	enum class ContextOwner {
+		NONE,
+		MAIN,
+		RENDER
+	};
+
+	void thread_loop();
+
+	GLFWwindow* window = nullptr;
+	std::function<void(const RenderSnapshot&)> draw;
+	std::thread thread;
+	bool running = false;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	ContextOwner owner = ContextOwner::MAIN;
+	bool main_wants_context = false;
+	bool stopping = false;
+	bool has_pending = false;
+	RenderSnapshot pending;
+	RenderSnapshot drawing;
+};
+
+extern RenderThread render_thread;
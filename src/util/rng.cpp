@@ -0,0 +1,58 @@
+#include "rng.hpp"
+#include <random>
+
+Rng rng;
+
+static uint32_t rotl(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+static uint64_t splitmix64(uint64_t& x) {
+	uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+Rng::Rng() {
+	std::random_device device;
+	seed(((uint64_t)device() << 32) | device());
+}
+
+void Rng::seed(uint64_t seed) {
+	seed_value = seed;
+	// splitmix64 spreads any seed, 0 included, over a state that is never all zero
+	uint64_t x = seed;
+	uint64_t a = splitmix64(x);
+	uint64_t b = splitmix64(x);
+	state[0] = (uint32_t)a;
+	state[1] = (uint32_t)(a >> 32);
+	state[2] = (uint32_t)b;
+	state[3] = (uint32_t)(b >> 32);
+}
+
+uint32_t Rng::next() {
+	const uint32_t result = rotl(state[1] * 5, 7) * 9;
+	const uint32_t t = state[1] << 9;
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+	return result;
+}
+
+float Rng::uniform() {
+	// the top 24 bits fill a float's mantissa exactly
+	return (float)(next() >> 8) * (1.f / 16777216.f);
+}
+
+float Rng::uniform(float min, float max) {
+	return min + (max - min) * uniform();
+}
+
+int Rng::below(int count) {
+	// multiply and keep the high half, no modulo
+	return (int)(((uint64_t)next() * (uint64_t)count) >> 32);
+}
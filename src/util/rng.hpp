@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// The simulation's one source of randomness: crits, drops, spawns, enemy attacks and room picks
+// all draw from the global rng, so the seed and the input reproduce a run exactly (see
+// --seed and --deterministic). xoshiro128** seeded through splitmix64, see https://prng.di.unimi.it/.
+// Only the exclusive tick systems draw from it, so it needs no locking.
+class Rng {
+public:
+	// seeded from std::random_device, so games differ unless a seed is given
+	Rng();
+
+	void seed(uint64_t seed);
+	uint64_t get_seed() const { return seed_value; }
+
+	uint32_t next();
+
+	// [0, 1)
+	float uniform();
+	// [min, max)
+	float uniform(float min, float max);
+	// [0, count), count > 0
+	int below(int count);
+
+private:
+	uint32_t state[4];
+	uint64_t seed_value = 0;
+};
+
+extern Rng rng;
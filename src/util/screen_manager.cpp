@@ -2,6 +2,7 @@
 #include <iostream>
 #include "../tinyECS/registry.hpp"
 #include "../systems/world_system.hpp"
+#include "render_thread.hpp"
 
 ScreenManager::ScreenManager(RenderSystem* renderSystem, WorldSystem* worldSystem, UpgradeSystem* upgrade_system) :
     currentScreen(ScreenType::StartScreen), renderer(renderSystem), world(worldSystem), upgrade_system(upgrade_system){}
@@ -31,6 +32,10 @@ void ScreenManager::setScreen(ScreenType newScreen) {
 }
 
 void ScreenManager::renderScreen() {
+    // menus draw directly on the main thread, only the play screen goes through the render thread
+    if (currentScreen != ScreenType::PlayScreen && currentScreen != ScreenType::TutorialScreen) {
+        render_thread.claim_context();
+    }
     switch(currentScreen) {
         case ScreenType::StartScreen:
             renderer->drawStartScreen(*this);
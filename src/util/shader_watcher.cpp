@@ -0,0 +1,67 @@
+#include "shader_watcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::~ShaderWatcher() {
+	stop();
+}
+
+#ifdef __linux__
+
+bool ShaderWatcher::start(const std::string& directory) {
+	stop();
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0) {
+		return false;
+	}
+	if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		stop();
+		return false;
+	}
+	return true;
+}
+
+void ShaderWatcher::stop() {
+	if (inotify_fd >= 0) {
+		close(inotify_fd);
+		inotify_fd = -1;
+	}
+}
+
+void ShaderWatcher::poll(std::vector<std::string>& changed_files) {
+	if (inotify_fd < 0) {
+		return;
+	}
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+		// EAGAIN once every pending event has been read
+		if (length <= 0) {
+			return;
+		}
+		for (char* p = buffer; p < buffer + length; ) {
+			inotify_event* event = (inotify_event*)p;
+			if (event->len > 0) {
+				changed_files.push_back(event->name);
+			}
+			p += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+
+#else
+
+bool ShaderWatcher::start(const std::string&) {
+	return false;
+}
+
+void ShaderWatcher::stop() {
+}
+
+void ShaderWatcher::poll(std::vector<std::string>&) {
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Watches a directory for files written or moved into it (editors often save by renaming
+// a temporary file), so shaders can be rebuilt while the game runs. Uses inotify and is
+// polled without blocking once per frame. On platforms without inotify start() fails and
+// poll() never reports anything.
+class ShaderWatcher {
+public:
+	ShaderWatcher() = default;
+	~ShaderWatcher();
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	bool start(const std::string& directory);
+	void stop();
+
+	// appends the names (not paths) of files changed since the last call
+	void poll(std::vector<std::string>& changed_files);
+
+private:
+	int inotify_fd = -1;
+};
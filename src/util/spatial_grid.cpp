@@ -0,0 +1,96 @@
+#include "spatial_grid.hpp"
+#include <cmath>
+
+SpatialGrid spatial_grid;
+
+// keeps a stray entity far off the map from blowing up the cell array
+const int SPATIAL_GRID_MAX_CELLS_PER_AXIS = 128;
+
+int SpatialGrid::cell_x(float x) const {
+	return clamp((int)floorf((x - origin.x) / cell_size), 0, width - 1);
+}
+
+int SpatialGrid::cell_y(float y) const {
+	return clamp((int)floorf((y - origin.y) / cell_size), 0, height - 1);
+}
+
+void SpatialGrid::rebuild() {
+	entries.clear();
+	ComponentContainer<Velocity>& velocity_registry = registry.velocities;
+	ComponentContainer<Position>& position_registry = registry.positions;
+	vec2 min_corner = { 0.f, 0.f };
+	vec2 max_corner = { 0.f, 0.f };
+	for (Entity& entity : velocity_registry.entities) {
+		if (!position_registry.has(entity)) continue;
+		vec2 position = position_registry.get(entity).position;
+		if (entries.size() == 0) {
+			min_corner = position;
+			max_corner = position;
+		}
+		min_corner = min(min_corner, position);
+		max_corner = max(max_corner, position);
+		entries.push_back({ entity, position });
+	}
+
+	origin = min_corner;
+	width = clamp((int)((max_corner.x - min_corner.x) / cell_size) + 1, 1, SPATIAL_GRID_MAX_CELLS_PER_AXIS);
+	height = clamp((int)((max_corner.y - min_corner.y) / cell_size) + 1, 1, SPATIAL_GRID_MAX_CELLS_PER_AXIS);
+
+	// counting sort of the entries by cell
+	cell_start.assign(width * height + 1, 0);
+	entry_cell.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		int cell = cell_y(entries[i].position.y) * width + cell_x(entries[i].position.x);
+		entry_cell[i] = cell;
+		cell_start[cell + 1]++;
+	}
+	for (int c = 0; c < width * height; c++) {
+		cell_start[c + 1] += cell_start[c];
+	}
+	cell_entries.resize(entries.size());
+	cell_fill.assign(cell_start.begin(), cell_start.end() - 1);
+	for (size_t i = 0; i < entries.size(); i++) {
+		cell_entries[cell_fill[entry_cell[i]]++] = (int)i;
+	}
+}
+
+void SpatialGrid::query_radius(vec2 center, float radius, std::vector<Entity>& out) const {
+	if (entries.size() == 0) {
+		return;
+	}
+	float radius_squared = radius * radius;
+	int x0 = cell_x(center.x - radius), x1 = cell_x(center.x + radius);
+	int y0 = cell_y(center.y - radius), y1 = cell_y(center.y + radius);
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			int cell = y * width + x;
+			for (int k = cell_start[cell]; k < cell_start[cell + 1]; k++) {
+				const Entry& entry = entries[cell_entries[k]];
+				vec2 difference = entry.position - center;
+				if (dot(difference, difference) <= radius_squared) {
+					out.push_back(entry.entity);
+				}
+			}
+		}
+	}
+}
+
+void SpatialGrid::query_aabb(vec2 min_corner, vec2 max_corner, std::vector<Entity>& out) const {
+	if (entries.size() == 0) {
+		return;
+	}
+	int x0 = cell_x(min_corner.x), x1 = cell_x(max_corner.x);
+	int y0 = cell_y(min_corner.y), y1 = cell_y(max_corner.y);
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			int cell = y * width + x;
+			for (int k = cell_start[cell]; k < cell_start[cell + 1]; k++) {
+				const Entry& entry = entries[cell_entries[k]];
+				if (entry.position.x >= min_corner.x && entry.position.x <= max_corner.x &&
+					entry.position.y >= min_corner.y && entry.position.y <= max_corner.y) {
+					out.push_back(entry.entity);
+				}
+			}
+		}
+	}
+}
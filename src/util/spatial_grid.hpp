@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../common.hpp"
+#include "../tinyECS/registry.hpp"
+#include <vector>
+
+// Uniform grid over the positions of every moving entity (everything with a Velocity),
+// rebuilt once per tick at the end of PhysicsSystem::step. Lets systems ask what is near
+// a point instead of scanning every entity. Results reflect positions at the last rebuild,
+// and may name entities removed since then, so callers check the containers they need.
+class SpatialGrid {
+public:
+	void rebuild();
+
+	// appends entities within radius of center to out
+	void query_radius(vec2 center, float radius, std::vector<Entity>& out) const;
+
+	// appends entities inside the box spanned by min_corner and max_corner to out
+	void query_aabb(vec2 min_corner, vec2 max_corner, std::vector<Entity>& out) const;
+
+private:
+	struct Entry {
+		Entity entity;
+		vec2 position;
+	};
+
+	int cell_x(float x) const;
+	int cell_y(float y) const;
+
+	const float cell_size = BASE_TILE_SIZE_WIDTH * 2.f;
+	vec2 origin = { 0.f, 0.f };
+	int width = 0;
+	int height = 0;
+
+	std::vector<Entry> entries;
+	// entries sorted by cell: cell c owns cell_entries[cell_start[c] .. cell_start[c + 1])
+	std::vector<int> cell_start;
+	std::vector<int> cell_entries;
+	// rebuild scratch
+	std::vector<int> entry_cell;
+	std::vector<int> cell_fill;
+};
+
+extern SpatialGrid spatial_grid;
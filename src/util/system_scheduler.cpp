@@ -0,0 +1,74 @@
+#include "system_scheduler.hpp"
+#include "frame_profiler.hpp"
+#include <algorithm>
+#include <iostream>
+
+static bool overlaps(const SystemScheduler::Resources& a, const SystemScheduler::Resources& b) {
+	for (const void* resource : a) {
+		if (std::find(b.begin(), b.end(), resource) != b.end()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SystemScheduler::conflicts(const System& a, const System& b) {
+	if (a.exclusive || b.exclusive) {
+		return true;
+	}
+	// reading the same data is fine, any write orders the two
+	return overlaps(a.writes, b.writes) || overlaps(a.writes, b.reads) || overlaps(a.reads, b.writes);
+}
+
+void SystemScheduler::add(const char* name, Resources reads, Resources writes, std::function<void(float)> step) {
+	add_system({ name, std::move(reads), std::move(writes), false }, std::move(step));
+}
+
+void SystemScheduler::add_exclusive(const char* name, std::function<void(float)> step) {
+	add_system({ name, {}, {}, true }, std::move(step));
+}
+
+void SystemScheduler::add_system(System system, std::function<void(float)> step) {
+	for (int i = 0; i < (int)systems.size(); i++) {
+		if (conflicts(systems[i], system)) {
+			system.after.push_back(i);
+		}
+	}
+	auto job = [this, step = std::move(step)]() { step(tick_ms); };
+	if (system.exclusive) {
+		graph.add_main(system.name, job, system.after);
+	}
+	else {
+		graph.add(system.name, job, system.after);
+	}
+	systems.push_back(std::move(system));
+}
+
+void SystemScheduler::run(float elapsed_ms) {
+	tick_ms = elapsed_ms;
+	graph.run();
+	for (int id = 0; id < graph.size(); id++) {
+		frame_profiler.record(graph.name(id), graph.duration_ms(id));
+	}
+}
+
+void SystemScheduler::print_graph() const {
+	std::cout << "Tick systems:" << std::endl;
+	for (const System& system : systems) {
+		std::cout << "  " << system.name << (system.exclusive ? " (main, exclusive)" : " (worker)");
+		// only the closest conflicts, the rest are implied through them
+		const char* separator = " after ";
+		for (int i : system.after) {
+			bool implied = false;
+			for (int j : system.after) {
+				const std::vector<int>& through = systems[j].after;
+				implied = implied || std::find(through.begin(), through.end(), i) != through.end();
+			}
+			if (!implied) {
+				std::cout << separator << systems[i].name;
+				separator = ", ";
+			}
+		}
+		std::cout << std::endl;
+	}
+}
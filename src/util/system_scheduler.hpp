@@ -0,0 +1,44 @@
+#pragma once
+
+#include "job_graph.hpp"
+#include <functional>
+#include <vector>
+
+// Runs the systems of one simulation tick as a dependency graph instead of one after another.
+// Each system declares the data it reads and writes, as addresses of registry containers or other
+// shared state (e.g. &registry.positions, &spatial_grid). A system waits for every system added
+// before it that writes something it touches, or touches something it writes, so the order
+// systems are added in stays the default and only systems without conflicts overlap.
+// Those run on the thread pool, exclusive systems (anything that creates or removes entities,
+// plays sounds or touches OpenGL) run on the main thread with nothing else in flight.
+class SystemScheduler {
+public:
+	using Resources = std::vector<const void*>;
+
+	void add(const char* name, Resources reads, Resources writes, std::function<void(float)> step);
+
+	// a system that may touch anything
+	void add_exclusive(const char* name, std::function<void(float)> step);
+
+	// runs one tick of every system, per-system times go to the frame profiler
+	void run(float elapsed_ms);
+
+	// prints each system with the systems it waits for
+	void print_graph() const;
+
+private:
+	struct System {
+		const char* name;
+		Resources reads;
+		Resources writes;
+		bool exclusive;
+		std::vector<int> after;
+	};
+
+	void add_system(System system, std::function<void(float)> step);
+	static bool conflicts(const System& a, const System& b);
+
+	std::vector<System> systems;
+	JobGraph graph;
+	float tick_ms = 0.f;
+};
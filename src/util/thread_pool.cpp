@@ -0,0 +1,103 @@
+#include "thread_pool.hpp"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+ThreadPool thread_pool;
+
+ThreadPool::ThreadPool() {
+	unsigned int hardware_threads = std::thread::hardware_concurrency();
+	size_t count = hardware_threads > 2 ? hardware_threads - 1 : 1;
+	for (size_t i = 0; i < count; i++) {
+		workers.emplace_back(&ThreadPool::worker_loop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		stopping = true;
+	}
+	jobs_cv.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobs_cv.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t count, size_t min_chunk, const std::function<void(size_t begin, size_t end)>& body) {
+	min_chunk = std::max(min_chunk, (size_t)1);
+	if (count < min_chunk * 2) {
+		body(0, count);
+		return;
+	}
+	// one chunk per thread, but none smaller than min_chunk
+	size_t chunks = std::min(workers.size() + 1, count / min_chunk);
+	size_t chunk_size = (count + chunks - 1) / chunks;
+
+	// shared with helpers that may only get to run after this call returned
+	struct Range {
+		const std::function<void(size_t, size_t)>* body;
+		size_t count;
+		size_t chunk_size;
+		size_t chunks;
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		std::mutex mutex;
+		std::condition_variable done_cv;
+
+		// runs chunks until none are left
+		void work() {
+			size_t chunk;
+			while ((chunk = next++) < chunks) {
+				size_t begin = chunk * chunk_size;
+				(*body)(begin, std::min(begin + chunk_size, count));
+				if (++done == chunks) {
+					std::lock_guard<std::mutex> lock(mutex);
+					done_cv.notify_all();
+				}
+			}
+		}
+	};
+	std::shared_ptr<Range> range = std::make_shared<Range>();
+	range->body = &body;
+	range->count = count;
+	range->chunk_size = chunk_size;
+	range->chunks = chunks;
+
+	for (size_t i = 1; i < chunks; i++) {
+		submit([range]() { range->work(); });
+	}
+	range->work();
+	// only waits on chunks already running on other threads
+	std::unique_lock<std::mutex> lock(range->mutex);
+	range->done_cv.wait(lock, [&range] { return range->done == range->chunks; });
+}
+
+size_t ThreadPool::worker_count() const {
+	return workers.size();
+}
+
+// runs queued jobs until the pool is destroyed, remaining jobs are finished first
+void ThreadPool::worker_loop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobs_mutex);
+			jobs_cv.wait(lock, [this] { return stopping || jobs.size() > 0; });
+			if (jobs.size() == 0) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads shared by every system that offloads work.
+// Jobs must not touch the registry or OpenGL, those belong to the main thread. The exception are
+// systems run by the SystemScheduler, which only touch the containers they declare.
+class ThreadPool {
+public:
+	// starts one worker per hardware thread, minus the main thread
+	ThreadPool();
+	~ThreadPool();
+
+	// queues job to run on a worker
+	void submit(std::function<void()> job);
+
+	// calls body(begin, end) over chunks of [0, count) on the workers and the calling thread, returns
+	// once every chunk is done. Ranges shorter than two chunks of min_chunk run serially on the caller.
+	// The caller works through chunks itself, so this is safe to call from a job on the pool.
+	void parallel_for(size_t count, size_t min_chunk, const std::function<void(size_t begin, size_t end)>& body);
+
+	size_t worker_count() const;
+
+private:
+	void worker_loop();
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobs_mutex;
+	std::condition_variable jobs_cv;
+	bool stopping = false;
+};
+
+extern ThreadPool thread_pool;